@@ -2,19 +2,41 @@
 // This file is part of TabsToSpaces utility
 // See LICENSE file for license and warranty information.
 #include "tabs_to_spaces.hpp"
+#include "tabs_to_spaces_blake3.hpp"
+#include "tabs_to_spaces_compressed.hpp"
+#include "tabs_to_spaces_tar.hpp"
+#include "tabs_to_spaces_file_system.hpp"
+#include "tabs_to_spaces_pipeline.hpp"
+#include "tabs_to_spaces_diff.hpp"
+#include "tabs_to_spaces_audit.hpp"
+#include "tabs_to_spaces_transaction.hpp"
+#include "tabs_to_spaces_git.hpp"
+#include "tabs_to_spaces_stats.hpp"
+#include "tabs_to_spaces_metrics.hpp"
+#include "tabs_to_spaces_buffer.hpp"
 
 #include <stdexcept>
 #include <string_view>
 #include <regex>
 #include <algorithm>
 #include <ranges>
-#include <fstream>
 #include <cstdint>
+#include <charconv>
+#include <functional>
+#include <span>
+#include <chrono>
+#include <cstring>
 
 #ifdef  TABS_TO_SPACES_TEST_ENABLED
 #include <iostream>
+#include <vector>
 #endif//TABS_TO_SPACES_TEST_ENABLED
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TABS_TO_SPACES_STREAMING_STORES
+#include <emmintrin.h>
+#endif
+
 #ifdef _WIN32
 #define WC(x) L##x
 #else
@@ -26,234 +48,1089 @@ namespace TabsToSpaces
 
     using namespace std::literals;
 
-    namespace
+    void Kernel::streamCopy(
+            char*           to,
+            char const*     from,
+            std::size_t     size
+        ) noexcept
     {
+    #ifdef  TABS_TO_SPACES_STREAMING_STORES
+        // Ordinary stores up to the alignment of the streaming ones and after the last of them.
+        auto const head = std::min(size, (16 - reinterpret_cast<std::uintptr_t>(to) % 16) % 16);
+        std::memcpy(to, from, head);
+        to   += head;
+        from += head;
+        size -= head;
+
+        for (; size >= 16; size -= 16, to += 16, from += 16) {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(to), _mm_loadu_si128(reinterpret_cast<__m128i const*>(from)));
+        }
+    #endif//TABS_TO_SPACES_STREAMING_STORES
 
-        // Find the position of a newline character sequence after space characters.
-        // Returns nullptr on non-space character.
-        [[nodiscard]] auto newlineProbe(
-                char const*     from,
-                char const*     to,
-                LineEndingMode  lineEndingMode
-            ) -> char const*
-        {
-            bool const ignore = lineEndingMode == LineEndingMode::Ignore;
-            for (bool hasCr = false; from != to; ++from) {
-                switch (auto const in = *from) {
-                case ' ':
-                case '\t':
-                    hasCr = false;
-                    break;
+        std::memcpy(to, from, size);
+    }
 
-                case '\r':
-                    hasCr = true;
-                    break;
+    void Kernel::streamFence() noexcept
+    {
+    #ifdef  TABS_TO_SPACES_STREAMING_STORES
+        _mm_sfence();
+    #endif//TABS_TO_SPACES_STREAMING_STORES
+    }
 
-                case '\n':
-                    if (ignore && hasCr) {
-                        return from - 1;
-                    }
-                    return from;
+    void Kernel::prefetchInput(
+            char const*     data,
+            std::size_t     size
+        ) noexcept
+    {
+        constexpr std::size_t cacheLine = 64;
+        for (std::size_t offset = 0; offset < size; offset += cacheLine) {
+        #if defined(TABS_TO_SPACES_STREAMING_STORES)
+            _mm_prefetch(data + offset, _MM_HINT_NTA);
+        #elif defined(__GNUC__)
+            __builtin_prefetch(data + offset, 0, 0);
+        #else
+            static_cast<void>(data);
+        #endif
+        }
+    }
 
-                default:
-                    return nullptr;
+
+    auto parseTabWidth(
+            std::string_view    spec,
+            Config              config
+        ) -> Config
+    {
+        auto const invalid = [spec]
+            {
+                return std::invalid_argument("Invalid tab width: "s + std::string{spec});
+            };
+
+        if (spec == "auto"sv) {
+            config.tabWidth = autoTabWidth;
+            config.tabStops = {};
+            return config;
+        }
+
+        TabStops tabStops;
+        for (std::size_t pos = 0; pos < spec.size();) {
+            auto const itemEnd = std::min(spec.find_first_of(", "sv, pos), spec.size());
+            auto number = spec.substr(pos, itemEnd - pos);
+            pos = itemEnd + 1;
+            if (number.empty()) {
+                continue;
+            }
+
+            if (tabStops.tailMode != TabStopTail::None) {
+                throw invalid(); // the tail must be the last item
+            }
+
+            if (number.starts_with('+')) {
+                tabStops.tailMode = TabStopTail::Increment;
+                number.remove_prefix(1);
+            } else if (number.starts_with('/')) {
+                tabStops.tailMode = TabStopTail::Multiple;
+                number.remove_prefix(1);
+            }
+
+            int value = 0;
+            auto const [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+            if (number.empty() || error != std::errc{} || end != number.data() + number.size()) {
+                throw invalid();
+            }
+
+            if (tabStops.tailMode != TabStopTail::None) {
+                tabStops.tail = value;
+            } else if (tabStops.count == TabStops::capacity) {
+                throw std::invalid_argument("Too many tab stops: "s + std::string{spec});
+            } else {
+                tabStops.stops[tabStops.count++] = value;
+            }
+        }
+
+        if (tabStops.count == 0 && tabStops.tailMode == TabStopTail::None) {
+            throw invalid();
+        }
+
+        if (tabStops.count == 0 || (tabStops.count == 1 && tabStops.tailMode == TabStopTail::None)) {
+            // A single width "n", "+n" or "/n" means a tab stop every n columns.
+            config.tabWidth = tabStops.count == 0 ? tabStops.tail : tabStops.stops[0];
+            config.tabStops = {};
+        } else {
+            config.tabStops = tabStops;
+        }
+
+        Kernel::checkTabWidth(config);
+        return config;
+    }
+
+
+    auto parseReindent(
+            std::string_view    spec,
+            Config              config
+        ) -> Config
+    {
+        auto const parse = [spec](std::string_view number)
+            {
+                int value = 0;
+                auto const [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+                if (number.empty() || error != std::errc{} || end != number.data() + number.size() || value < 0) {
+                    throw std::invalid_argument("Invalid indentation: "s + std::string{spec});
                 }
+
+                return value;
+            };
+
+        if (auto const colon = spec.find(':'); colon != spec.npos) {
+            config.sourceIndent = parse(spec.substr(0, colon));
+            config.targetIndent = parse(spec.substr(colon + 1));
+            if (config.sourceIndent == 0) {
+                throw std::invalid_argument("Invalid indentation: "s + std::string{spec});
+            }
+        } else {
+            config.sourceIndent = autoIndent;
+            config.targetIndent = parse(spec);
+        }
+
+        return config;
+    }
+
+
+    Converter::Converter(Config config)
+        : requested_(config)
+        , config_(config)
+        , detecting_(Kernel::detectsStyle(config))
+    {
+        if (!detecting_) {
+            start({});
+        }
+    }
+
+    void Converter::start(std::string_view sample)
+    {
+        config_ = Kernel::detectStyle(sample, requested_);
+        Kernel::checkTabWidth(config_);
+        Kernel::checkIndent(config_);
+        if (config_.tabStops.count != 0) {
+            tabStopTable_ = Kernel::makeTabStopTable(config_.tabStops);
+        }
+
+        tabRegions_ = Kernel::TabRegions{ config_.tabProtection };
+        detecting_  = false;
+    }
+
+    auto Converter::convertPart(
+            std::string_view    part,
+            std::string&        output,
+            bool                last
+        ) -> std::string_view
+    {
+        auto convertWith = [&](auto const& tabs, auto& regions)
+            {
+                bool const expands = config_.conversion == Conversion::TabsToSpaces;
+                auto const oldSize = output.size();
+                output.resize(oldSize
+                    + Kernel::estimateConvertedSize(part, config_, tabs)
+                    + 1); // a pending CR from the previous part
+
+                auto const read  = part.data();
+                auto const write = output.data() + oldSize;
+                auto const [readStop, writeStop] = expands
+                    ? Kernel::convertRange(
+                        read, read + part.size(), write, config_, tabs, regions, column_, hasCr_, leading_, last)
+                    : Kernel::unexpandRange(
+                        read, read + part.size(), write, config_, tabs, regions, column_, hasCr_, leading_, last);
+
+            #ifdef  TABS_TO_SPACES_TEST_ENABLED
+                if (writeStop > output.data() + output.size()) {
+                    throw std::logic_error("Converter: invalid output size estimate detected");
+                }
+            #endif//TABS_TO_SPACES_TEST_ENABLED
+
+                output.resize(writeStop - output.data());
+                return part.substr(readStop - read);
+            };
+
+        auto convertWithTabs = [&](auto& regions)
+            {
+                if (config_.tabStops.count == 0) {
+                    return convertWith(Kernel::UniformTabs{ config_.tabWidth }, regions);
+                }
+
+                return convertWith(tabStopTable_, regions);
+            };
+
+        if (config_.tabProtection == TabProtection::None
+         || config_.tabProtection == TabProtection::Auto) {
+            Kernel::NoRegions regions;
+            return convertWithTabs(regions);
+        }
+
+        return convertWithTabs(tabRegions_);
+    }
+
+    void Converter::convert(
+            std::string_view    chunk,
+            std::string&        output
+        )
+    {
+        if (detecting_) {
+            auto const taken = std::min(chunk.size(), Kernel::styleSampleSize - sample_.size());
+            sample_ += chunk.substr(0, taken);
+            chunk.remove_prefix(taken);
+            if (sample_.size() < Kernel::styleSampleSize) {
+                return;
+            }
+
+            start(sample_);
+            convertUnbuffered(sample_, output);
+            sample_.clear();
+        }
+
+        convertUnbuffered(chunk, output);
+    }
+
+    void Converter::convertUnbuffered(
+            std::string_view    chunk,
+            std::string&        output
+        )
+    {
+        if (config_.byteOrderMark == ByteOrderMark::Strip && !headDone_) {
+            auto const bom   = Kernel::utf8ByteOrderMark;
+            auto const taken = std::min(chunk.size(), bom.size() - head_.size());
+            head_ += chunk.substr(0, taken);
+            chunk.remove_prefix(taken);
+            if (head_.size() < bom.size() && bom.starts_with(head_)) {
+                return; // may still be a BOM
+            }
+
+            headDone_ = true;
+            if (head_ != bom) {
+                convertChunk(head_, output);
+            }
+
+            head_.clear();
+        }
+
+        convertChunk(chunk, output);
+    }
+
+    void Converter::convertChunk(
+            std::string_view    chunk,
+            std::string&        output
+        )
+    {
+        auto const appendStart = output.size();
+        bool const holds       = Kernel::transformsTail(config_);
+        if (holds) {
+            output += held_;
+            held_.clear();
+        }
+
+        if (!pending_.empty()) {
+            // Extend the pending whitespace run up to the first character that resolves it.
+            auto const resolved = chunk.find_first_not_of(" \t\r"sv);
+            if (resolved == chunk.npos) {
+                pending_ += chunk;
+                chunk = {};
+            } else {
+                pending_ += chunk.substr(0, resolved + 1);
+                chunk.remove_prefix(resolved + 1);
+
+                [[maybe_unused]] auto const rest = convertPart(pending_, output, false);
+                pending_.clear();
             }
+        }
 
-            return to;
+        if (pending_.empty()) {
+            pending_ = convertPart(chunk, output, false);
         }
 
+        if (holds) {
+            holdTail(output, appendStart);
+        }
     }
 
+    void Converter::holdTail(
+            std::string&    output,
+            std::size_t     appendStart
+        )
+    {
+        std::string_view const appended = std::string_view{output}.substr(appendStart);
+        if (newline_.empty()) {
+            newline_ = Kernel::newlineIn(appended);
+        }
+
+        auto const content = appended.find_last_not_of(Kernel::lineSpaces);
+        auto const tailStart = content == appended.npos ? appendStart : appendStart + content + 1;
+        hasContent_ = hasContent_ || content != appended.npos;
 
-    [[nodiscard]] auto estimateOutputSize(
-            std::string_view    fileContents,
-            int                 tabWidth,
-            LineEndingMode      lineEndingMode
-        ) -> std::size_t
+        held_.assign(output, tailStart);
+        output.resize(tailStart);
+    }
+
+    void Converter::finish(std::string& output)
     {
-        auto const tabSpaceEstimate  = std::ranges::count(fileContents, '\t') * tabWidth;
-        auto const additionalCrCount = std::ranges::count(fileContents, '\n');
-        return fileContents.size() + tabSpaceEstimate + additionalCrCount;
+        if (detecting_) {
+            start(sample_);
+            convertUnbuffered(sample_, output);
+            sample_.clear();
+        }
+
+        if (!headDone_ && !head_.empty()) {
+            convertChunk(head_, output);
+        }
+
+        auto const appendStart = output.size();
+        output += held_;
+
+        std::string pending;
+        pending.swap(pending_);
+        [[maybe_unused]] auto const rest = convertPart(pending, output, true);
+
+        if (Kernel::transformsTail(config_)) {
+            holdTail(output, appendStart);
+            Kernel::finishTail(held_, hasContent_, Kernel::finalNewline(config_.lineEndingMode, newline_), config_);
+            output += held_;
+        }
+
+        column_      = 0;
+        hasCr_       = false;
+        leading_     = true;
+        tabRegions_  = Kernel::TabRegions{ config_.tabProtection };
+        detecting_   = Kernel::detectsStyle(requested_);
+        head_.clear();
+        headDone_    = false;
+        held_.clear();
+        hasContent_  = false;
+        newline_     = {};
     }
 
 
-    auto tabsToSpaces(
-            std::string_view    fileContents,
+    auto reconvertEdit(
+            std::string_view    converted,
+            TextEdit            edit,
             Config              config
-        ) -> std::string
+        ) -> TextReplacement
     {
-        auto const tabWidth = config.tabWidth;
-        if (tabWidth < 1) {
-            throw std::invalid_argument("tabsToSpaces: tab width must be greater than zero");
+        if (edit.offset > converted.size() || edit.length > converted.size() - edit.offset) {
+            throw std::out_of_range("reconvertEdit: edit range is out of the buffer");
         }
 
-        auto const lineEndingMode = config.lineEndingMode;
-        std::string output(
-            estimateOutputSize(fileContents, tabWidth, lineEndingMode),
-            '\0');
+        if (Kernel::reindents(config)) {
+            // The converted lines around the edit are re-indented already.
+            throw std::invalid_argument("reconvertEdit: re-indentation cannot be applied twice");
+        }
 
-        auto       write   = output.data();
-        auto       read    = fileContents.data();
-        auto const readEnd = read + fileContents.size();
+        // Automatic settings are resolved by the whole buffer, not by the edited lines.
+        if (Kernel::detectsStyle(config)) {
+            config = Kernel::detectStyle(converted, config);
+        }
 
-        int  column = 0;
-        bool hasCr  = false;
+        // Conversion state (column, pending CR) is reset after each LF,
+        // so it is enough to reconvert the whole lines the edit touches.
+        auto const editEnd = edit.offset + edit.length;
+        auto const prevLf  = edit.offset == 0 ? converted.npos : converted.rfind('\n', edit.offset - 1);
+        auto const nextLf  = converted.find('\n', editEnd);
+        auto lineStart     = prevLf == converted.npos ? 0 : prevLf + 1;
+        auto lineEnd       = nextLf == converted.npos ? converted.size() : nextLf + 1;
 
-        bool const trim = config.whitespaceBeforeNewLines == WhitespaceBeforeNewLines::Trim;
-        bool const lf   = lineEndingMode == LineEndingMode::Lf;
-        bool const crlf = lineEndingMode == LineEndingMode::CrLf;
+        auto const nextLineEnd = [converted](std::size_t from)
+            {
+                auto const lf = converted.find('\n', from);
+                return lf == converted.npos ? converted.size() : lf + 1;
+            };
 
-        while (read != readEnd) {
-            switch (auto const in = *read++) {
-            case '\t':
-                if (trim) {
-                    if (auto nlPos = newlineProbe(read - 1, readEnd, lineEndingMode)) {
-                        read = nlPos;
-                        continue;
-                    }
-                }
+        // The state of tab protection is not reset after each LF (raw strings, block comments):
+        // the lines after the edit are reconverted as long as the edit changes the state they start in.
+        bool const protects = config.tabProtection != TabProtection::None
+                           && config.tabProtection != TabProtection::Auto;
+        if (protects) {
+            Kernel::TabRegions before{ config.tabProtection };
+            before.start(converted.data());
+            before.stop(converted.data() + lineStart);
+
+            auto const editedLines = std::string{converted.substr(lineStart, edit.offset - lineStart)}
+                + std::string{edit.replacement} + std::string{converted.substr(editEnd, lineEnd - editEnd)};
+
+            auto oldState = before;
+            oldState.stop(converted.data() + lineEnd);
+
+            auto newState = before;
+            newState.start(editedLines.data());
+            newState.stop(editedLines.data() + editedLines.size());
+
+            while (lineEnd != converted.size() && !oldState.sameState(newState)) {
+                auto const next = nextLineEnd(lineEnd);
+                oldState.stop(converted.data() + next);
+                newState.start(converted.data() + lineEnd);
+                newState.stop(converted.data() + next);
+                lineEnd = next;
+            }
+        }
 
-                if (lf && hasCr) {
-                    *write++ = '\r';
+        // Deleting trailing blank lines reaches the blank lines before the edit.
+        if (lineEnd == converted.size() && config.trailingBlankLines == TrailingBlankLines::Delete) {
+            while (lineStart != 0) {
+                auto const prev      = lineStart < 2 ? converted.npos : converted.rfind('\n', lineStart - 2);
+                auto const prevStart = prev == converted.npos ? 0 : prev + 1;
+                if (converted.substr(prevStart, lineStart - prevStart).find_first_not_of(" \t\r\n"sv) != converted.npos) {
+                    break;
                 }
 
-                for (; column < tabWidth; ++column) {
-                    *write++ = ' ';
+                lineStart = prevStart;
+            }
+        }
+
+        // The lines are reconverted from the last line starting in the initial state of tab protection.
+        if (protects) {
+            Kernel::TabRegions const initial{ config.tabProtection };
+            Kernel::TabRegions       scan = initial;
+            scan.start(converted.data());
+
+            std::size_t cleanStart = 0;
+            for (std::size_t next = 0; (next = nextLineEnd(next)) <= lineStart && next != converted.size(); ) {
+                scan.stop(converted.data() + next);
+                if (scan.sameState(initial)) {
+                    cleanStart = next;
                 }
+            }
+
+            lineStart = cleanStart;
+        }
+
+        // The transforms of the ends of the text apply only if the lines are at that end.
+        if (lineStart != 0) {
+            config.byteOrderMark = ByteOrderMark::Keep;
+        }
+
+        if (lineEnd != converted.size()) {
+            config.finalNewline       = FinalNewline::Keep;
+            config.trailingBlankLines = TrailingBlankLines::Keep;
+        }
+
+        std::string edited;
+        edited.reserve(lineEnd - lineStart - edit.length + edit.replacement.size());
+        edited += converted.substr(lineStart, edit.offset - lineStart);
+        edited += edit.replacement;
+        edited += converted.substr(editEnd, lineEnd - editEnd);
+
+        auto       text = tabsToSpaces(std::string_view{edited}, config);
+        auto const old  = converted.substr(lineStart, lineEnd - lineStart);
+
+        // Shrink the replacement to the bytes that actually differ.
+        auto const common = std::min(old.size(), text.size());
+
+        std::size_t prefix = 0;
+        while (prefix < common && old[prefix] == text[prefix]) {
+            ++prefix;
+        }
+
+        std::size_t suffix = 0;
+        while (suffix < common - prefix
+            && old[old.size() - 1 - suffix] == text[text.size() - 1 - suffix]) {
+            ++suffix;
+        }
+
+        text.erase(text.size() - suffix);
+        text.erase(0, prefix);
 
-                column = 0;
-                hasCr  = false;
-                break;
+        return TextReplacement
+            {
+                .offset = lineStart + prefix,
+                .length = old.size() - prefix - suffix,
+                .text   = std::move(text)
+            };
+    }
+
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    [[nodiscard]] auto toString(
+            LineEndingMode lineEndingMode
+        ) noexcept -> std::string_view
+    {
+        using enum LineEndingMode;
+        switch (lineEndingMode) {
+        case Ignore: return "Ignore"sv;
+        case Lf:     return "Lf"sv;
+        case CrLf:   return "CrLf"sv;
+        case Auto:   return "Auto"sv;
+        }
+
+        return "Unknown"sv;
+    }
+
+    [[nodiscard]] auto toString(
+            WhitespaceBeforeNewLines whitespaceBeforeNewLines
+        ) noexcept -> std::string_view
+    {
+        using enum WhitespaceBeforeNewLines;
+        switch (whitespaceBeforeNewLines) {
+        case DoNotTrim: return "DoNotTrim"sv;
+        case Trim:      return "Trim"sv;
+        }
+
+        return "Unknown"sv;
+    }
+
+
+    // Compile-time conversion uses the same kernel as the run-time one.
+    static_assert(tabsToSpaces("\tone\r\n..\ttwo \r\n"sv, { .tabWidth = 3 }) == "   one\r\n.. two \r\n"sv);
+
+    constexpr auto embeddedText = tabsToSpacesArray<
+            "\tone\r\n..\ttwo \r\n",
+            Config{ .tabWidth = 3, .lineEndingMode = LineEndingMode::Lf,
+                    .whitespaceBeforeNewLines = WhitespaceBeforeNewLines::Trim }
+        >();
+
+    static_assert(std::string_view{ embeddedText.data(), embeddedText.size() } == "   one\n.. two\n"sv);
+
+
+    struct Quoted
+    {
+        std::string_view data;
+    };
+
+    auto operator<<(std::ostream& os, Quoted quoted)
+        -> std::ostream&
+    {
+        os << '"';
+
+        static constexpr std::string_view hex     = "0123456789abcdef"sv;
+        static constexpr std::string_view special = "\t\r\n\\\""sv;
+        static constexpr std::string_view substitute[]
+        {
+            "\\t"sv, "\\r"sv, "\\n"sv, "\\\\"sv, "\\\""sv
+        };
+
+        constexpr int SPACE = 32; // ASCII
+
+        for (auto in : quoted.data) {
+            if (auto sp = special.find(in); sp != special.npos) {
+                os << substitute[sp];
+            } else if (unsigned char code = in; code < SPACE) {
+                os << "\\x"sv << hex[in >> 4] << hex[in & 0xF];
+            } else {
+                os.put(in);
+            }
+        }
+
+        os << '"';
+        return os;
+    }
+
+
+    [[nodiscard]] int test_tabsToSpaces(
+            std::string_view    file,
+            Config              config,
+            std::string_view    expected
+        )
+    {
+        if (auto answer = tabsToSpaces(file, config); answer != expected) {
+            std::clog << "Test failed: tabsToSpaces("sv
+                      << Quoted{ file }                            << ", "sv
+                      << config.tabWidth                           << ", "sv
+                      << toString(config.lineEndingMode)           << ", "sv
+                      << toString(config.whitespaceBeforeNewLines) << ") ==\n"sv
+                      << Quoted{ answer }                          << "\n!=\n"sv
+                      << Quoted{ expected }                        << '\n';
+
+            return 1;
+        }
+
+        // The same input split into two segments at each position and into single bytes.
+        std::vector<std::string_view> bytes;
+        for (std::size_t i = 0; i < file.size(); ++i) {
+            bytes.push_back(file.substr(i, 1));
+        }
+
+        if (auto answer = tabsToSpaces(bytes, config); answer != expected) {
+            std::clog << "Test failed: bytewise tabsToSpaces("sv
+                      << Quoted{ file }   << ") ==\n"sv
+                      << Quoted{ answer } << '\n';
+
+            return 1;
+        }
+
+        for (std::size_t i = 0; i <= file.size(); ++i) {
+            std::string_view const halves[] { file.substr(0, i), file.substr(i) };
+            if (auto answer = tabsToSpaces(halves, config); answer != expected) {
+                std::clog << "Test failed: tabsToSpaces("sv
+                          << Quoted{ halves[0] } << " + "sv
+                          << Quoted{ halves[1] } << ") ==\n"sv
+                          << Quoted{ answer }    << '\n';
+
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    [[nodiscard]] int test_reconvertEdit()
+    {
+        struct TestCase
+        {
+            std::string_view            file;
+            TextEdit                    edit;
+            LineEndingMode              lineEndingMode              = LineEndingMode::Ignore;
+            WhitespaceBeforeNewLines    whitespaceBeforeNewLines    = WhitespaceBeforeNewLines::DoNotTrim;
+            bool                        transforms                  = false;
+            TabProtection               tabProtection               = TabProtection::None;
+        };
+
+        constexpr TestCase testCases[]
+        {
+            { "\tone\n\ttwo\n\tthree"sv, { 0, 0, "\t"sv } },
+            { "\tone\n\ttwo\n\tthree"sv, { 6, 3, "x\ty"sv } },
+            { "\tone\n\ttwo\n\tthree"sv, { 8, 0, "\n\t\t"sv } },
+            { "\tone\n\ttwo\n\tthree"sv, { 4, 1, ""sv } },
+            { "\tone\n\ttwo\n\tthree"sv, { 20, 0, "\t!"sv } },
+            { "a\r\nb\r\nc"sv, { 3, 0, "x\t\r\n"sv }, LineEndingMode::Lf },
+            { "a\r\nb\r\nc"sv, { 1, 0, "\n\t"sv }, LineEndingMode::CrLf },
+            { "a\nb  \nc"sv, { 2, 1, "b\t \t"sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::Trim },
+            { "a\n\nb\n"sv, { 4, 1, " "sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::DoNotTrim, true },
+            { "a\n\nb\n"sv, { 5, 0, "\n\n"sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::DoNotTrim, true },
+            { "a"sv, { 0, 0, "\xEF\xBB\xBF"sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::DoNotTrim, true },
+            { "a\n\n\nb\n"sv, { 4, 1, ""sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::DoNotTrim, true },
+            { "\n\nb\n"sv, { 2, 1, ""sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::DoNotTrim, true },
+            { "R\"(\nx\ty\n)\";\n"sv, { 4, 0, "\t"sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::DoNotTrim,
+                false, TabProtection::CLike },
+            { "R\"(\n\tx\n)\";\n\ty\n"sv, { 0, 1, ""sv }, LineEndingMode::Ignore, WhitespaceBeforeNewLines::DoNotTrim,
+                false, TabProtection::CLike },
+        };
+
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            Config const config
+                {
+                    .lineEndingMode             = testCase.lineEndingMode,
+                    .whitespaceBeforeNewLines   = testCase.whitespaceBeforeNewLines,
+                    .tabProtection              = testCase.tabProtection,
+                    .byteOrderMark              = testCase.transforms ? ByteOrderMark::Strip : ByteOrderMark::Keep,
+                    .finalNewline               = testCase.transforms ? FinalNewline::Ensure : FinalNewline::Keep,
+                    .trailingBlankLines         = testCase.transforms ? TrailingBlankLines::Delete : TrailingBlankLines::Keep
+                };
+
+            auto const converted = tabsToSpaces(testCase.file, config);
+            auto const edit      = testCase.edit;
+
+            auto edited = converted;
+            edited.replace(edit.offset, edit.length, edit.replacement);
+
+            auto const replacement = reconvertEdit(converted, edit, config);
+            auto answer = converted;
+            answer.replace(replacement.offset, replacement.length, replacement.text);
+
+            if (auto const expected = tabsToSpaces(std::string_view{edited}, config); answer != expected) {
+                std::clog << "Test failed: reconvertEdit("sv
+                          << Quoted{ converted }         << ", "sv
+                          << edit.offset                 << ", "sv
+                          << edit.length                 << ", "sv
+                          << Quoted{ edit.replacement }  << ") ==\n"sv
+                          << Quoted{ answer }            << "\n!=\n"sv
+                          << Quoted{ expected }          << '\n';
+
+                ++errors;
+            }
+        }
+
+        return errors;
+    }
+
+    [[nodiscard]] int test_tabStops()
+    {
+        struct TestCase
+        {
+            std::string_view tabStops;
+            std::string_view expected;
+        };
+
+        // Expected results are produced by GNU expand -t.
+        constexpr std::string_view file = "a\tb\tc\td\te\tf\n\t\tx\t\n"sv;
+        constexpr TestCase testCases[]
+        {
+            { "4,8,20"sv, "a   b   c           d e f\n        x           \n"sv },
+            { "2,+5"sv,   "a b    c    d    e    f\n       x    \n"sv },
+            { "3,/5"sv,   "a  b c    d    e    f\n     x    \n"sv },
+            { "3"sv,      "a  b  c  d  e  f\n      x  \n"sv },
+            { "1 2"sv,    "a b c d e f\n  x \n"sv },
+        };
+
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            errors += test_tabsToSpaces(file, parseTabWidth(testCase.tabStops, {}), testCase.expected);
+        }
+
+        for (auto invalid : { ""sv, "4,x"sv, "8,4"sv, "4,+2,8"sv, "0"sv, "4,/0"sv }) {
+            try {
+                [[maybe_unused]] auto const config = parseTabWidth(invalid, {});
+                std::clog << "Test failed: parseTabWidth("sv << Quoted{ invalid } << ") did not throw\n"sv;
+                ++errors;
+            } catch (std::invalid_argument const&) {
+            }
+        }
+
+        return errors;
+    }
+
+    [[nodiscard]] int test_tabRegions()
+    {
+        struct TestCase
+        {
+            TabProtection               tabProtection;
+            std::string_view            file;
+            std::string_view            expected;
+            WhitespaceBeforeNewLines    whitespaceBeforeNewLines = WhitespaceBeforeNewLines::DoNotTrim;
+        };
+
+        constexpr TestCase testCases[]
+        {
+            {
+                TabProtection::Makefile,
+                "all:\tdep\n\tcc -o\tx\n  \tnot\n\t"sv,
+                "all:    dep\n\tcc -o\tx\n    not\n\t"sv
+            },
+
+            {
+                TabProtection::Tsv,
+                "a\tb \t\n\t\n"sv,
+                "a\tb \t\n\t\n"sv,
+                WhitespaceBeforeNewLines::Trim
+            },
+
+            {
+                TabProtection::CLike,
+                "\tx = \"a\tb\"; // c\td\n"
+                "\tc = '\t'; s = R\"d(\t)\")d\"; t = \"\\\"\t\";\n"
+                "\t/* \" */ y\t1'000\t\n"sv,
+                "    x = \"a\tb\"; // c    d\n"
+                "    c = '\t'; s = R\"d(\t)\")d\"; t = \"\\\"\t\";\n"
+                "    /* \" */ y   1'000   \n"sv
+            },
+        };
+
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            errors += test_tabsToSpaces(
+                    testCase.file,
+                    {
+                        .whitespaceBeforeNewLines   = testCase.whitespaceBeforeNewLines,
+                        .tabProtection              = testCase.tabProtection
+                    },
+                    testCase.expected
+                );
+        }
+
+        return errors;
+    }
+
+    [[nodiscard]] int test_transforms()
+    {
+        struct TestCase
+        {
+            std::string_view            file;
+            std::string_view            expected;
+            ByteOrderMark               byteOrderMark       = ByteOrderMark::Strip;
+            FinalNewline                finalNewline        = FinalNewline::Ensure;
+            TrailingBlankLines          trailingBlankLines  = TrailingBlankLines::Delete;
+            LineEndingMode              lineEndingMode      = LineEndingMode::Ignore;
+        };
+
+        constexpr TestCase testCases[]
+        {
+            { ""sv, ""sv },
+            { "\xEF\xBB\xBF"sv, ""sv },
+            { " \n\t\n"sv, ""sv },
+            { "\xEF\xBB\xBF\tx"sv, "    x\n"sv },
+            { "\xEF\xBB\xBF\tx"sv, "\xEF\xBB\xBF x"sv, ByteOrderMark::Keep, FinalNewline::Keep },
+            { "\xEF\xBBx"sv, "\xEF\xBBx\n"sv },
+            { "x\r\ny  \r\n\r\n \t\r\n"sv, "x\r\ny  \r\n"sv },
+            { "x\r\ny  \r\n\r\n \t\r\n"sv, "x\r\ny  \r\n\r\n    \r\n"sv,
+                ByteOrderMark::Strip, FinalNewline::Ensure, TrailingBlankLines::Keep },
+            { "x\r\ny \t"sv, "x\r\ny   \r\n"sv },
+            { "x\r\ny"sv, "x\ny\n"sv, ByteOrderMark::Strip, FinalNewline::Ensure,
+                TrailingBlankLines::Delete, LineEndingMode::Lf },
+            { "x\n\n\ny\n\n"sv, "x\n\n\ny\n"sv },
+            { "x\n\n"sv, "x\n\n"sv, ByteOrderMark::Strip, FinalNewline::Ensure, TrailingBlankLines::Keep },
+        };
+
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            errors += test_tabsToSpaces(
+                    testCase.file,
+                    {
+                        .lineEndingMode     = testCase.lineEndingMode,
+                        .byteOrderMark      = testCase.byteOrderMark,
+                        .finalNewline       = testCase.finalNewline,
+                        .trailingBlankLines = testCase.trailingBlankLines
+                    },
+                    testCase.expected
+                );
+        }
+
+        return errors;
+    }
+
+    [[nodiscard]] int test_detectStyle()
+    {
+        struct TestCase
+        {
+            std::string_view            file;
+            int                         tabWidth;
+            LineEndingMode              lineEndingMode;
+        };
+
+        constexpr TestCase testCases[]
+        {
+            { "a\r\nb\r\nc\n"sv,                         4, LineEndingMode::CrLf   },
+            { "a\nb\r\nc\n"sv,                            4, LineEndingMode::Lf     },
+            { "a\nb\r\n"sv,                               4, LineEndingMode::Ignore },
+            { "if\n  x\n    y\n\n  z\n"sv,                 2, LineEndingMode::Lf     },
+            { "f\r\n    x\r\n        y\r\n\tz\r\n"sv,      4, LineEndingMode::CrLf   },
+            { "f\n  x\n    y\n      z\n\tw\n\t  v\n"sv,    8, LineEndingMode::Lf     },
+            { "f\n\tx\n\t\ty\n"sv,                         4, LineEndingMode::Lf     },
+        };
+
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            auto const config = Kernel::detectStyle(
+                    testCase.file,
+                    { .tabWidth = autoTabWidth, .lineEndingMode = LineEndingMode::Auto });
+
+            if (config.tabWidth != testCase.tabWidth || config.lineEndingMode != testCase.lineEndingMode) {
+                std::clog << "Test failed: detectStyle("sv
+                          << Quoted{ testCase.file }            << ") == "sv
+                          << config.tabWidth                    << ", "sv
+                          << toString(config.lineEndingMode)    << '\n';
+
+                ++errors;
+            }
+        }
+
+        errors += test_tabsToSpaces(
+                "f\r\n  x\n  \ty\r\n"sv,
+                { .tabWidth = autoTabWidth, .lineEndingMode = LineEndingMode::Auto },
+                "f\r\n  x\r\n    y\r\n"sv
+            );
+
+        return errors;
+    }
+
+    [[nodiscard]] int test_spacesToTabs()
+    {
+        struct TestCase
+        {
+            std::string_view            file;
+            std::string_view            expected;
+            Conversion                  conversion      = Conversion::SpacesToTabs;
+            TabProtection               tabProtection   = TabProtection::None;
+        };
+
+        // Expected results are the same as of GNU unexpand -t 4 (-a or --first-only).
+        constexpr TestCase testCases[]
+        {
+            { "        x\n"sv,       "\t\tx\n"sv },
+            { "a   b\n"sv,           "a\tb\n"sv },
+            { "abc d\n"sv,           "abc d\n"sv },
+            { "abc  d\n"sv,          "abc\t d\n"sv },
+            { "abc \td\n"sv,         "abc\t\td\n"sv },
+            { "x\ty  \n  "sv,        "x\ty  \n  "sv },
+            { "  \tx a   b\n"sv,     "\tx a   b\n"sv,     Conversion::LeadingSpacesToTabs },
+            { "    s = \"a   b\";    // c\n"sv, "\ts = \"a   b\";\t// c\n"sv,
+                Conversion::SpacesToTabs, TabProtection::CLike },
+            { "    x:  y\n\t    z  w\n"sv, "    x:\ty\n\t    z  w\n"sv,
+                Conversion::SpacesToTabs, TabProtection::Makefile },
+            { "a   b\tc\n"sv,         "a   b\tc\n"sv,
+                Conversion::SpacesToTabs, TabProtection::Tsv },
+        };
+
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            errors += test_tabsToSpaces(
+                    testCase.file,
+                    {
+                        .tabProtection  = testCase.tabProtection,
+                        .conversion     = testCase.conversion
+                    },
+                    testCase.expected
+                );
+        }
+
+        // Past the last stop of a list the rest of the line is kept.
+        errors += test_tabsToSpaces(
+                "x          y\n"sv,
+                { .tabStops = parseTabWidth("4,8"sv, {}).tabStops, .conversion = Conversion::SpacesToTabs },
+                "x\t\t   y\n"sv
+            );
+
+        errors += test_tabsToSpaces(
+                "    a  \t \n\tb\n"sv,
+                {
+                    .lineEndingMode             = LineEndingMode::CrLf,
+                    .whitespaceBeforeNewLines   = WhitespaceBeforeNewLines::Trim,
+                    .conversion                 = Conversion::SpacesToTabs
+                },
+                "\ta\r\n\tb\r\n"sv
+            );
+
+        return errors;
+    }
+
+    [[nodiscard]] int test_reindent()
+    {
+        struct TestCase
+        {
+            std::string_view            file;
+            std::string_view            expected;
+            int                         sourceIndent;
+            int                         targetIndent;
+            int                         tabWidth        = 4;
+            Conversion                  conversion      = Conversion::TabsToSpaces;
+            TabProtection               tabProtection   = TabProtection::None;
+        };
+
+        constexpr TestCase testCases[]
+        {
+            { "a\n  b\n    c\n\td\n"sv,   "a\n    b\n        c\n        d\n"sv,   2, 4 },
+            { "f\n  x\n    y\n"sv,        "f\n    x\n        y\n"sv,            autoIndent, 4 },
+            { "f\n\tx\n\t\ty\n"sv,        "f\n    x\n        y\n"sv,            autoIndent, 4, 8 },
+            { "   x\n"sv,                 "     x\n"sv,                         2, 4 },
+            { "  x\ty\n"sv,               "    x   y\n"sv,                     2, 4 },
+            { "        x  y\n"sv,         "\tx  y\n"sv,                        4, 2, 4,
+                Conversion::LeadingSpacesToTabs },
+            { "R\"(\n  a)\"\n  b\n"sv,     "R\"(\n  a)\"\n    b\n"sv,             2, 4, 4,
+                Conversion::TabsToSpaces, TabProtection::CLike },
+        };
+
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            errors += test_tabsToSpaces(
+                    testCase.file,
+                    {
+                        .tabWidth       = testCase.tabWidth,
+                        .tabProtection  = testCase.tabProtection,
+                        .conversion     = testCase.conversion,
+                        .sourceIndent   = testCase.sourceIndent,
+                        .targetIndent   = testCase.targetIndent
+                    },
+                    testCase.expected
+                );
+        }
 
-            case '\n':
-                if (crlf && !hasCr) {
-                    *write++ = '\r';
-                }
+        errors += test_tabsToSpaces(
+                "  \n  x \n"sv,
+                {
+                    .whitespaceBeforeNewLines   = WhitespaceBeforeNewLines::Trim,
+                    .sourceIndent               = 2,
+                    .targetIndent               = 4
+                },
+                "\n    x\n"sv
+            );
 
-                *write++ = in;
-                column   = 0;
-                hasCr    = false;
-                break;
+        return errors;
+    }
 
-            default:
-                if (trim && in == ' ') {
-                    if (auto nlPos = newlineProbe(read - 1, readEnd, lineEndingMode)) {
-                        read = nlPos;
-                        continue;
-                    }
-                }
+    [[nodiscard]] int test_convertStreaming()
+    {
+        int errors = 0;
 
-                if (lf && hasCr) {
-                    *write++ = '\r';
-                } // else writes CR immediately.
+        // Pieces ending within whitespace runs (some spanning several pieces), CR LF and protected tabs.
+        auto const piece = Kernel::streamingPieceSize;
+        std::string text = "\xEF\xBB\xBF"s;
+        for (int i = 0; text.size() < 12 * piece; ++i) {
+            text += std::string(i % 3, '\t') + "x = \"a\tb\";"s + std::string(i % 11, ' ') + (i % 4 == 0 ? "\r\n"s : "\n"s);
+            if (i == 700) {
+                text += std::string(piece + 5, ' ') + "\t\n"s;
+            } else if (i == 900) {
+                text += std::string(3 * piece, ' ') + "y\n"s;
+            } else if (i == 1100) {
+                text += std::string(piece, '\t') + "\r"s + std::string(2 * piece, ' ') + "\r\n"s;
+            }
+        }
 
-                hasCr = in == '\r';
-                if (!lf || !hasCr) {
-                    *write++ = in;
-                } // else writes CR before the next character that is not LF.
+        text += std::string(2 * piece + 3, ' ');
 
-                // CR and NUL are assumed to have zero width.
-                column += in != '\0' && in != '\r';
-                if (column == tabWidth) {
-                    column = 0;
-                }
-            }
+        Config trimming;
+        trimming.whitespaceBeforeNewLines = WhitespaceBeforeNewLines::Trim;
+        trimming.lineEndingMode           = LineEndingMode::Lf;
 
-        #ifdef  TABS_TO_SPACES_TEST_ENABLED
-            if (static_cast<std::size_t>(write - output.data()) > output.size()) {
-                throw std::logic_error("tabsToSpaces: invalid output size estimate detected");
-            }
-        #endif//TABS_TO_SPACES_TEST_ENABLED
-        }
+        Config protecting;
+        protecting.tabProtection = TabProtection::CLike;
 
-        output.resize(write - output.data());
-        return output;
-    }
+        Config toTabs;
+        toTabs.conversion = Conversion::SpacesToTabs;
 
+        Config reindenting;
+        reindenting.sourceIndent = 2;
+        reindenting.targetIndent = 4;
 
-#ifdef  TABS_TO_SPACES_TEST_ENABLED
-    [[nodiscard]] auto toString(
-            LineEndingMode lineEndingMode
-        ) noexcept -> std::string_view
-    {
-        using enum LineEndingMode;
-        switch (lineEndingMode) {
-        case Ignore: return "Ignore"sv;
-        case Lf:     return "Lf"sv;
-        case CrLf:   return "CrLf"sv;
-        }
+        for (auto const& config : { Config{}, trimming, protecting, toTabs, reindenting }) {
+            auto const expected = tabsToSpaces(std::string_view{text}, config);
+            auto const actual   = Kernel::withTabs(config, [&](auto const& tabs)
+                {
+                    return Kernel::withRegions(config, [&](auto& regions)
+                        {
+                            std::string output(Kernel::estimateConvertedSize(text, config, tabs) + 1, '\0');
+                            auto const end = Kernel::convertStreaming(
+                                text.data(), text.data() + text.size(), output.data() + 1, config, tabs, regions);
 
-        return "Unknown"sv;
-    }
+                            // Misaligned by one byte on purpose.
+                            return output.substr(1, static_cast<std::size_t>(end - output.data() - 1));
+                        });
+                });
 
-    [[nodiscard]] auto toString(
-            WhitespaceBeforeNewLines whitespaceBeforeNewLines
-        ) noexcept -> std::string_view
-    {
-        using enum WhitespaceBeforeNewLines;
-        switch (whitespaceBeforeNewLines) {
-        case DoNotTrim: return "DoNotTrim"sv;
-        case Trim:      return "Trim"sv;
+            if (actual != expected) {
+                std::clog << "Test failed: convertStreaming\n"sv;
+                ++errors;
+            }
         }
 
-        return "Unknown"sv;
+        return errors;
     }
 
-
-    struct Quoted
-    {
-        std::string_view data;
-    };
-
-    auto operator<<(std::ostream& os, Quoted quoted)
-        -> std::ostream&
+    [[nodiscard]] int test_blake3()
     {
-        os << '"';
-
-        static constexpr std::string_view hex     = "0123456789abcdef"sv;
-        static constexpr std::string_view special = "\t\r\n\\\""sv;
-        static constexpr std::string_view substitute[]
+        struct TestCase
         {
-            "\\t"sv, "\\r"sv, "\\n"sv, "\\\\"sv, "\\\""sv
+            std::size_t                 length;     // of the official test input: bytes i % 251
+            std::string_view            expected;
         };
 
-        constexpr int SPACE = 32; // ASCII
+        constexpr TestCase testCases[]
+        {
+            {    0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262"sv },
+            {    1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213"sv },
+            { 1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7"sv },
+            { 1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444"sv },
+            { 2048, "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a"sv },
+        };
 
-        for (auto in : quoted.data) {
-            if (auto sp = special.find(in); sp != special.npos) {
-                os << substitute[sp];
-            } else if (unsigned char code = in; code < SPACE) {
-                os << "\\x"sv << hex[in >> 4] << hex[in & 0xF];
-            } else {
-                os.put(in);
+        int errors = 0;
+        for (auto& testCase : testCases) {
+            std::string input(testCase.length, '\0');
+            for (std::size_t i = 0; i < input.size(); ++i) {
+                input[i] = static_cast<char>(i % 251);
             }
-        }
 
-        os << '"';
-        return os;
-    }
+            Blake3 whole;
+            whole.update(input);
 
+            Blake3 parts;
+            for (std::string_view rest{input}; !rest.empty(); rest.remove_prefix(std::min<std::size_t>(rest.size(), 100))) {
+                parts.update(rest.substr(0, 100));
+            }
 
-    [[nodiscard]] int test_tabsToSpaces(
-            std::string_view    file,
-            Config              config,
-            std::string_view    expected
-        )
-    {
-        if (auto answer = tabsToSpaces(file, config); answer != expected) {
-            std::clog << "Test failed: tabsToSpaces("sv
-                      << Quoted{ file }                            << ", "sv
-                      << config.tabWidth                           << ", "sv
-                      << toString(config.lineEndingMode)           << ", "sv
-                      << toString(config.whitespaceBeforeNewLines) << ") ==\n"sv
-                      << Quoted{ answer }                          << "\n!=\n"sv
-                      << Quoted{ expected }                        << '\n';
+            for (auto const& hash : { whole, parts }) {
+                if (auto const hex = Blake3::toHex(hash.digest()); hex != testCase.expected) {
+                    std::clog << "Test failed: BLAKE3 of "sv << testCase.length
+                              << " bytes == "sv << hex << '\n';
 
-            return 1;
+                    ++errors;
+                }
+            }
         }
 
-        return 0;
+        return errors;
     }
 
     int test_tabsToSpaces()
@@ -366,6 +1243,11 @@ namespace TabsToSpaces
                 "..\r\n    ..  \r    ..  \r\r    ..\r\n    ..\r\n\r\n    ..\r\n\r    .."sv,
                 LineEndingMode::CrLf, WhitespaceBeforeNewLines::Trim
             },
+
+            {
+                4, "\t.\r"sv, "    .\r"sv,
+                LineEndingMode::Lf
+            },
         };
 
         int errors = 0;
@@ -381,6 +1263,26 @@ namespace TabsToSpaces
                 );
         }
 
+        errors += test_reconvertEdit();
+        errors += test_tabStops();
+        errors += test_tabRegions();
+        errors += test_transforms();
+        errors += test_detectStyle();
+        errors += test_spacesToTabs();
+        errors += test_reindent();
+        errors += test_convertStreaming();
+        errors += test_blake3();
+        errors += test_compressed();
+        errors += test_tar();
+        errors += test_fileSystem();
+        errors += test_pipeline();
+        errors += test_diff();
+        errors += test_audit();
+        errors += test_transaction();
+        errors += test_git();
+        errors += test_stats();
+        errors += test_metrics();
+        errors += test_buffer();
         return errors;
     }
 #endif//TABS_TO_SPACES_TEST_ENABLED
@@ -388,49 +1290,426 @@ namespace TabsToSpaces
 
     namespace fs = std::filesystem;
 
+    auto detectTabProtection(fs::path const& filename)
+        -> TabProtection
+    {
+        using NameView = std::basic_string_view<fs::path::value_type>;
+
+        constexpr NameView makefileNames[]
+        {
+            WC("Makefile"sv), WC("makefile"sv), WC("GNUmakefile"sv)
+        };
+
+        constexpr NameView makefileExtensions[] { WC(".mk"sv), WC(".mak"sv) };
+        constexpr NameView tsvExtensions[]      { WC(".tsv"sv), WC(".tab"sv) };
+        constexpr NameView cLikeExtensions[]
+        {
+            WC(".c"sv),   WC(".h"sv),   WC(".cc"sv),  WC(".cpp"sv), WC(".cxx"sv), WC(".c++"sv),
+            WC(".hh"sv),  WC(".hpp"sv), WC(".hxx"sv), WC(".h++"sv), WC(".ipp"sv), WC(".inl"sv),
+            WC(".cs"sv),  WC(".java"sv)
+        };
+
+        auto const name      = filename.filename().native();
+        auto const extension = filename.extension().native();
+
+        if (std::ranges::contains(makefileNames, NameView{name})
+         || std::ranges::contains(makefileExtensions, NameView{extension})) {
+            return TabProtection::Makefile;
+        }
+
+        if (std::ranges::contains(tsvExtensions, NameView{extension})) {
+            return TabProtection::Tsv;
+        }
+
+        if (std::ranges::contains(cLikeExtensions, NameView{extension})) {
+            return TabProtection::CLike;
+        }
+
+        return TabProtection::None;
+    }
+
+
     namespace
     {
 
-        [[nodiscard]] auto loadFileToString(fs::path const& filename)
-            -> std::string
+        // Output is written in blocks which are hashed while still in cache.
+        constexpr std::size_t writeBlockSize = 1 << 20;
+
+        // Where the result of processing the file goes in the output directory.
+        [[nodiscard]] auto mirrorPath(
+                fs::path const& filename,
+                fs::path const& outputDirectory
+            ) -> fs::path
         {
-            auto const fileSizeUmax = fs::file_size(filename);
-            if (fileSizeUmax > SIZE_MAX) {
-                throw std::length_error("File is too big: "s + filename.string());
+            auto const absolute = fs::absolute(filename).lexically_normal();
+            auto relative = absolute.lexically_relative(fs::current_path());
+            if (relative.empty() || *relative.begin() == WC(".."sv)) {
+                relative = absolute.relative_path();
             }
 
-            auto const fileSize = static_cast<std::size_t>(fileSizeUmax);
-            std::string bytes(fileSize, '\0');
+            return outputDirectory / relative;
+        }
 
-            std::ifstream file(filename, std::ios::binary);
-            if (!file.is_open()) {
-                throw std::runtime_error("File read failed: "s + filename.string());
+        // Finish writing the temporary file.
+        void closeTemp(TempFile& file)
+        {
+            file.stream->flush();
+            if (!*file.stream) {
+                throw std::runtime_error("File write failed: "s + file.path.string());
             }
 
-            file.read(bytes.data(), fileSize);
-            return bytes;
+            file.stream.reset();
         }
 
-        void processOneFile(
+        // Where to write the result of processing the file.
+        [[nodiscard]] auto prepareTarget(
+                FileSystem&         files,
+                fs::path const&     filename,
+                FileOptions const&  options
+            ) -> fs::path
+        {
+            if (options.outputDirectory.empty()) {
+                return filename;
+            }
+
+            auto target = mirrorPath(filename, options.outputDirectory);
+            if (files.equivalent(filename, target)) {
+                throw std::invalid_argument("Output file is the input file: "s + filename.string());
+            }
+
+            files.createDirectories(target.parent_path());
+            return target;
+        }
+
+        // Keep the target in the transaction before it is replaced or created.
+        void saveTarget(
+                Transaction*    transaction,
+                fs::path const& target
+            )
+        {
+            if (transaction != nullptr) {
+                transaction->save(target);
+            }
+        }
+
+        [[nodiscard]] auto readHead(
+                FileSystem&     files,
+                fs::path const& filename
+            ) -> std::string
+        {
+            auto const file = files.openRead(filename);
+
+            std::string head(compressionMagicSize, '\0');
+            file->read(head.data(), head.size());
+            head.resize(static_cast<std::size_t>(file->gcount()));
+            return head;
+        }
+
+        // Stream the file through convert(input, output, inputHash, outputHash) -> StreamResult
+        // into a temporary file which replaces the target if the content changed.
+        template <typename Convert>
+        void processStreamedFile(
+                FileSystem&     files,
+                fs::path const& filename,
+                fs::path const& target,
+                Transaction*    transaction,
+                Report*         report,
+                Convert const&  convert
+            )
+        {
+            bool const hashing = report != nullptr && report->outputHash() == OutputHash::Blake3;
+            Blake3 inputHash;
+            Blake3 outputHash;
+
+            auto const input = files.openRead(filename);
+
+            StreamResult stream;
+            auto output = files.writeTemp(target);
+            try {
+                stream = convert(*input, *output.stream,
+                        hashing ? &inputHash : nullptr, hashing ? &outputHash : nullptr);
+
+                closeTemp(output);
+            } catch (...) {
+                output.stream.reset();
+                files.remove(output.path);
+                throw;
+            }
+
+            FileResult result;
+            result.path      = filename;
+            result.inputSize = stream.inputSize;
+
+            if (stream.changed) {
+                result.outcome    = FileOutcome::Converted;
+                result.outputSize = stream.outputSize;
+                saveTarget(transaction, target);
+                files.replace(output.path, target);
+            } else {
+                // Keep the original bytes.
+                result.outputSize = stream.inputSize;
+                files.remove(output.path);
+                if (target != filename) {
+                    saveTarget(transaction, target);
+                    files.copy(filename, target);
+                }
+            }
+
+            if (report != nullptr) {
+                if (hashing) {
+                    result.hash = Blake3::toHex((stream.changed ? outputHash : inputHash).digest());
+                }
+
+                report->add(std::move(result));
+            }
+        }
+
+        // Stream a compressed file through decompression, conversion and compression.
+        void processCompressedFile(
+                FileSystem&     files,
+                fs::path const& filename,
+                fs::path const& target,
+                Config const&   config,
+                Compression     compression,
+                Transaction*    transaction,
+                Report*         report
+            )
+        {
+            if (!supportsCompression(compression)) {
+                throw std::runtime_error("Compression format is not supported in this build: "s
+                    + std::string{toString(compression)} + ": "s + filename.string());
+            }
+
+            processStreamedFile(files, filename, target, transaction, report,
+                [&](std::istream& input, std::ostream& output, Blake3* inputHash, Blake3* outputHash)
+                {
+                    return convertCompressed(input, output, compression, config, inputHash, outputHash);
+                });
+        }
+
+        // Files from this size on are converted in chunks with reading and writing overlapping
+        // the conversion instead of being loaded whole.
+        constexpr std::uintmax_t pipelinedFileSize = std::uintmax_t{16} << 20;
+
+        void processLargeFile(
+                FileSystem&     files,
                 fs::path const& filename,
-                Config          config
+                fs::path const& target,
+                Config const&   config,
+                Transaction*    transaction,
+                Report*         report
+            )
+        {
+            processStreamedFile(files, filename, target, transaction, report,
+                [&](std::istream& input, std::ostream& output, Blake3* inputHash, Blake3* outputHash)
+                {
+                    return convertPipelined(input, output, config, inputHash, outputHash);
+                });
+        }
+
+        void convertOneFile(
+                FileSystem&         files,
+                fs::path const&     filename,
+                fs::path const&     target,
+                FileStatus const&   status,
+                Config              config,
+                FileOptions const&  options,
+                Report*             report
             )
         {
-            auto input  = loadFileToString(filename);
-            auto output = tabsToSpaces(std::string_view{input}, config);
+            bool const diffing = options.diff != nullptr;
+            auto* const stats  = options.stats;
+            if (options.compressedFiles == CompressedFiles::Stream) {
+                auto const head = timed(stats, Phase::Read, [&] { return readHead(files, filename); });
+                if (auto const compression = detectCompression(head); compression != Compression::None) {
+                    if (diffing) {
+                        throw std::invalid_argument("Compressed files are not diffed: "s + filename.string());
+                    }
+
+                    if (config.tabProtection == TabProtection::Auto) {
+                        config.tabProtection = detectTabProtection(filename.stem()); // e.g. name.c.gz
+                    }
+
+                    return timed(stats, Phase::Convert, [&]
+                        {
+                            processCompressedFile(files, filename, target, config, compression, options.transaction, report);
+                        });
+                }
+            }
+
+            if (config.tabProtection == TabProtection::Auto) {
+                config.tabProtection = detectTabProtection(filename);
+            }
+
+            if (!diffing && status.size >= pipelinedFileSize) {
+                return timed(stats, Phase::Convert, [&]
+                    {
+                        processLargeFile(files, filename, target, config, options.transaction, report);
+                    });
+            }
+
+            auto input  = timed(stats, Phase::Read,    [&] { return files.read(filename); });
+            auto output = timed(stats, Phase::Convert, [&] { return tabsToSpaces(std::string_view{input}, config, options.largeBuffers); });
+
+            bool const hashing = report != nullptr && report->outputHash() == OutputHash::Blake3;
+            FileResult result;
+            result.path       = filename;
+            result.inputSize  = input.size();
+            result.outputSize = output.size();
 
-            if (input != output) {
+            Blake3 hash;
+            if (diffing) {
+                if (timed(stats, Phase::Write, [&] { return writeUnifiedDiff(*options.diff, filename, input, output.view()); })) {
+                    result.outcome = FileOutcome::Converted;
+                }
+
+                if (hashing) {
+                    hash.update(output.view());
+                }
+            } else if (input != output.view()) {
                 input = std::string{};
+                result.outcome = FileOutcome::Converted;
+
+                timed(stats, Phase::Write, [&]
+                    {
+                        auto file = files.writeTemp(target);
+                        try {
+                            for (auto rest = output.view(); !rest.empty(); ) {
+                                auto const block = rest.substr(0, writeBlockSize);
+                                file.stream->write(block.data(), block.size());
+                                if (hashing) {
+                                    hash.update(block);
+                                }
+
+                                rest.remove_prefix(block.size());
+                            }
+
+                            closeTemp(file);
+                        } catch (...) {
+                            file.stream.reset();
+                            files.remove(file.path);
+                            throw;
+                        }
+
+                        output.release();
+                        saveTarget(options.transaction, target);
+                        files.replace(file.path, target);
+                    });
+            } else {
+                if (target != filename) {
+                    timed(stats, Phase::Write, [&]
+                        {
+                            saveTarget(options.transaction, target);
+                            files.copy(filename, target);
+                        });
+                }
+
+                if (hashing) {
+                    // Unchanged: the output is the input which is already in memory.
+                    hash.update(output.view());
+                }
+            }
+
+            if (report != nullptr) {
+                if (hashing) {
+                    result.hash = Blake3::toHex(hash.digest());
+                }
 
-                fs::path outputName = filename;
-                outputName += WC(".tabs2spaces.tmp"sv);
+                report->add(std::move(result));
+            }
+        }
+
+        // Hex digest of everything the output depends on besides the input. A format version
+        // comes first so markers of other versions never match.
+        [[nodiscard]] auto cleanMarkerDigest(
+                Config const&       config,
+                FileOptions const&  options
+            ) -> std::string
+        {
+            std::string fields = "1"s;
+            auto add = [&fields](int value)
+                {
+                    fields += ' ';
+                    fields += std::to_string(value);
+                };
+
+            add(config.tabWidth);
+            add(config.tabStops.count);
+            for (auto stop : std::span{ config.tabStops.stops }.first(static_cast<std::size_t>(config.tabStops.count))) {
+                add(stop);
+            }
+
+            add(config.tabStops.tail);
+            add(static_cast<int>(config.tabStops.tailMode));
+            add(static_cast<int>(config.lineEndingMode));
+            add(static_cast<int>(config.whitespaceBeforeNewLines));
+            add(static_cast<int>(config.tabProtection));
+            add(static_cast<int>(config.byteOrderMark));
+            add(static_cast<int>(config.finalNewline));
+            add(static_cast<int>(config.trailingBlankLines));
+            add(static_cast<int>(config.conversion));
+            add(config.sourceIndent);
+            add(config.targetIndent);
+            add(static_cast<int>(options.compressedFiles));
+
+            Blake3 hash;
+            hash.update(fields);
+            return Blake3::toHex(hash.digest()).substr(0, 32);
+        }
+
+        // The marker of a clean file: the config digest, then the modification time and size it has.
+        [[nodiscard]] auto cleanMarker(
+                std::string_view    configDigest,
+                FileStatus const&   status
+            ) -> std::string
+        {
+            return std::string{configDigest} + ' ' + std::to_string(status.modified) + ' ' + std::to_string(status.size);
+        }
+
+        void processOneFile(
+                FileSystem&         files,
+                fs::path const&     filename,
+                Config const&       config,
+                FileOptions const&  options,
+                std::string const&  configDigest,     // empty unless clean markers are used
+                Report*             report
+            )
+        {
+            auto const start   = std::chrono::steady_clock::now();
+            auto const status  = timed(options.stats, Phase::Stat, [&] { return files.status(filename); });
+            bool const diffing = options.diff != nullptr;
+            auto const target  = diffing ? filename : prepareTarget(files, filename, options);
+            // The marker is read from the file it was written to, so an output directory has none.
+            bool const marking = !diffing && !configDigest.empty() && target == filename;
+
+            static std::string const attribute{cleanMarkerAttribute};
+
+            // One stat and one attribute read decide, the content is not read.
+            if (marking && status.type == FileType::Regular
+             && files.readAttribute(filename, attribute) == cleanMarker(configDigest, status)) {
+                if (report != nullptr) {
+                    FileResult result;
+                    result.path       = filename;
+                    result.outcome    = FileOutcome::Skipped;
+                    result.inputSize  = status.size;
+                    result.outputSize = status.size;
+                    report->add(std::move(result));
+                }
+            } else {
+                convertOneFile(files, filename, target, status, config, options, report);
 
-                std::ofstream file(outputName, std::ios::binary);
-                file.write(output.data(), output.size());
-                file.close();
+                // The target is clean now; the marker is an optimization, so failing to store it is fine.
+                if (marking) {
+                    if (auto const targetStatus = files.status(target); targetStatus.type == FileType::Regular) {
+                        files.writeAttribute(target, attribute, cleanMarker(configDigest, targetStatus));
+                    }
+                }
+            }
 
-                output = std::string{};
-                fs::rename(outputName, filename);
+            if (options.stats != nullptr) {
+                auto const elapsed = std::chrono::steady_clock::now() - start;
+                options.stats->addFile({ filename, status.size,
+                    static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) });
             }
         }
 
@@ -468,12 +1747,51 @@ namespace TabsToSpaces
             return result;
         }
 
+        // Call process for the files matching the regex in the directory and its subdirectories if nested.
+        void walkDirectory(
+                FileSystem&                                     files,
+                fs::path const&                                 directory,
+                std::basic_regex<fs::path::value_type> const&   filenameRegex,
+                DirectoryWalk                                   walk,
+                std::span<fs::path const>                       skipDirectories,
+                std::function<void(fs::path const&)> const&     process
+            )
+        {
+            for (auto const& entry : files.list(directory)) {
+                if (entry.type == FileType::Directory) {
+                    if (walk == DirectoryWalk::Nested
+                     && std::ranges::none_of(skipDirectories, [&](fs::path const& skip)
+                            {
+                                return !skip.empty() && files.equivalent(entry.path, skip);
+                            })) {
+                        walkDirectory(files, entry.path, filenameRegex, walk, skipDirectories, process);
+                    }
+
+                    continue;
+                }
+
+            #ifdef  TABS_TO_SPACES_TEST_ENABLED
+                std::clog << "Testing "sv << entry.path.filename() << '\n';
+            #endif
+                if (entry.type == FileType::Regular
+                 && std::regex_match(entry.path.filename().native(), filenameRegex)) {
+                #ifdef  TABS_TO_SPACES_TEST_ENABLED
+                    std::clog << "Processing: "sv << entry.path << '\n';
+                #endif
+                    process(entry.path);
+                }
+            }
+        }
+
     }
 
 
-    void tabsToSpaces(
-            fs::path const& path,
-            Config          config
+    void forEachMatchingFile(
+            FileSystem&                                     files,
+            fs::path const&                                 path,
+            DirectoryWalk                                   walk,
+            std::function<void(fs::path const&)> const&     process,
+            std::span<fs::path const>                       skipDirectories
         )
     {
     #ifdef  TABS_TO_SPACES_TEST_ENABLED
@@ -482,7 +1800,7 @@ namespace TabsToSpaces
 
         auto const filename = path.filename();
         if (!detectRegexPath(filename.native())) {
-            return processOneFile(path, config);
+            return process(path);
         }
 
     #ifdef  TABS_TO_SPACES_TEST_ENABLED
@@ -498,36 +1816,59 @@ namespace TabsToSpaces
             #endif
             );
 
-        auto fileCond = [&filenameRegex](fs::directory_entry const& e)
-            {
-            #ifdef  TABS_TO_SPACES_TEST_ENABLED
-                std::clog << "Testing "sv << e.path().filename() << '\n';
-            #endif
-                return e.is_regular_file()
-                    && std::regex_match(e.path().filename().native(), filenameRegex);
-            };
+        walkDirectory(files, path.parent_path(), filenameRegex, walk, skipDirectories, process);
+    }
+
 
-        auto fileProcess = [config](fs::directory_entry const& e)
+    namespace
+    {
+
+        void processPath(
+                fs::path const&     path,
+                Config              config,
+                FileOptions const&  options,
+                Report*             report
+            )
+        {
+            auto& files = options.fileSystem != nullptr ? *options.fileSystem : nativeFileSystem();
+            auto const configDigest = options.cleanMarkers == CleanMarkers::Use
+                ? cleanMarkerDigest(config, options) : std::string{};
+
+            // Do not process the results again if the output directory is within the input tree,
+            // nor the snapshot of the transaction.
+            fs::path const skipDirectories[]
             {
-            #ifdef  TABS_TO_SPACES_TEST_ENABLED
-                std::clog << "Processing: "sv << e << '\n';
-            #endif
-                processOneFile(e.path(), config);
+                options.outputDirectory,
+                options.transaction != nullptr ? options.transaction->directory() : fs::path{},
             };
 
-        switch (config.directoryWalk) {
-        case DirectoryWalk::OneLevel:
-            std::ranges::for_each(
-                fs::directory_iterator(path.parent_path()) | std::views::filter(fileCond),
-                fileProcess);
-            break;
-
-        case DirectoryWalk::Nested:
-            std::ranges::for_each(
-                fs::recursive_directory_iterator(path.parent_path()) | std::views::filter(fileCond),
-                fileProcess);
-            break;
+            forEachMatchingFile(files, path, config.directoryWalk,
+                [&](fs::path const& filename)
+                {
+                    processOneFile(files, filename, config, options, configDigest, report);
+                },
+                skipDirectories);
         }
+
+    }
+
+
+    void tabsToSpaces(
+            fs::path const& path,
+            Config          config
+        )
+    {
+        processPath(path, config, {}, nullptr);
+    }
+
+    void tabsToSpaces(
+            fs::path const&     path,
+            Config              config,
+            Report&             report,
+            FileOptions const&  options
+        )
+    {
+        processPath(path, config, options, &report);
     }
 
 }
@@ -7,6 +7,20 @@
 #include <string>
 #include <string_view>
 #include <filesystem>
+#include <ranges>
+#include <concepts>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <iosfwd>
+#include <functional>
+#include <span>
+#include <type_traits>
+
+#include "tabs_to_spaces_regions.hpp"
+#include "tabs_to_spaces_report.hpp"
 
 #if defined(_DEBUG) || defined(DEBUG)
 #define TABS_TO_SPACES_TEST_ENABLED
@@ -20,6 +34,7 @@ namespace TabsToSpaces
         Ignore,
         Lf,
         CrLf,
+        Auto,       // the dominant one of Lf and CrLf in the file
     };
 
     enum class WhitespaceBeforeNewLines
@@ -34,24 +49,1381 @@ namespace TabsToSpaces
         Nested
     };
 
+    enum class ByteOrderMark
+    {
+        Keep,
+        Strip,      // delete UTF-8 BOM at the beginning
+    };
+
+    enum class FinalNewline
+    {
+        Keep,
+        Ensure,     // end non-empty output with a new-line
+    };
+
+    enum class TrailingBlankLines
+    {
+        Keep,
+        Delete,     // delete whitespace-only lines at the end
+    };
+
+    enum class Conversion
+    {
+        TabsToSpaces,
+        SpacesToTabs,           // blanks reaching a tab stop become tabs (like unexpand -a)
+        LeadingSpacesToTabs,    // the same only for the blanks beginning a line (like unexpand)
+    };
+
+    enum class TabStopTail
+    {
+        None,       // past the last stop each tab becomes a single space
+        Increment,  // stops continue every tail columns after the last stop ("+n" in expand -t)
+        Multiple,   // stops continue at multiples of tail ("/n" in expand -t)
+    };
+
+    // Explicit tab stop columns like in expand -t 4,8,20 (zero-based, ascending).
+    struct TabStops
+    {
+        static constexpr int capacity = 32;
+
+        std::array<int, capacity>   stops       {};
+        int                         count       = 0;
+        int                         tail        = 0;
+        TabStopTail                 tailMode    = TabStopTail::None;
+    };
+
+    // Config::tabWidth value to detect the tab width from the file indentation.
+    inline constexpr int autoTabWidth = 0;
+
+    // Config::sourceIndent value to detect the indentation unit of the file.
+    inline constexpr int autoIndent = 0;
+
     struct Config
     {
-        int                      tabWidth                   = 4;
+        int                      tabWidth                   = 4;  // used if tabStops is empty
+        TabStops                 tabStops                   = {};
         LineEndingMode           lineEndingMode             = LineEndingMode::Ignore;
         WhitespaceBeforeNewLines whitespaceBeforeNewLines   = WhitespaceBeforeNewLines::DoNotTrim;
         DirectoryWalk            directoryWalk              = DirectoryWalk::OneLevel;
+        TabProtection            tabProtection              = TabProtection::None;
+        ByteOrderMark            byteOrderMark              = ByteOrderMark::Keep;
+        FinalNewline             finalNewline               = FinalNewline::Keep;
+        TrailingBlankLines       trailingBlankLines         = TrailingBlankLines::Keep;
+        Conversion               conversion                 = Conversion::TabsToSpaces;
+        int                      sourceIndent               = autoIndent; // columns per indentation level
+        int                      targetIndent               = 0;  // rescale leading indentation to it if not 0
     };
 
-    [[nodiscard]] auto tabsToSpaces(
+    // The conversion kernel is constexpr to be usable both at run time and in constant evaluation.
+    namespace Kernel
+    {
+
+        // Find the position of a newline character sequence after space characters.
+        // Returns nullptr on non-space character.
+        [[nodiscard]] constexpr auto newlineProbe(
+                char const*     from,
+                char const*     to,
+                LineEndingMode  lineEndingMode,
+                bool            tabIsSpace
+            ) -> char const*
+        {
+            bool const ignore = lineEndingMode == LineEndingMode::Ignore;
+            for (bool hasCr = false; from != to; ++from) {
+                switch (*from) {
+                case '\t':
+                    if (!tabIsSpace) {
+                        return nullptr;
+                    }
+                    [[fallthrough]];
+
+                case ' ':
+                    hasCr = false;
+                    break;
+
+                case '\r':
+                    hasCr = true;
+                    break;
+
+                case '\n':
+                    if (ignore && hasCr) {
+                        return from - 1;
+                    }
+                    return from;
+
+                default:
+                    return nullptr;
+                }
+            }
+
+            return to;
+        }
+
+        [[nodiscard]] constexpr auto estimateOutputSize(
+                std::string_view    fileContents,
+                int                 maxTabSpaces
+            ) -> std::size_t
+        {
+            auto const tabSpaceEstimate  = std::ranges::count(fileContents, '\t') * maxTabSpaces;
+            auto const additionalCrCount = std::ranges::count(fileContents, '\n');
+            return fileContents.size() + tabSpaceEstimate + additionalCrCount;
+        }
+
+        constexpr void checkTabWidth(Config const& config)
+        {
+            auto const& tabStops = config.tabStops;
+            if (tabStops.count == 0) {
+                if (config.tabWidth < 1) {
+                    throw std::invalid_argument("tabsToSpaces: tab width must be greater than zero");
+                }
+
+                return;
+            }
+
+            if (tabStops.count < 0 || tabStops.count > TabStops::capacity) {
+                throw std::invalid_argument("tabsToSpaces: invalid tab stop count");
+            }
+
+            for (int previous = 0, i = 0; i < tabStops.count; previous = tabStops.stops[i++]) {
+                if (tabStops.stops[i] <= previous) {
+                    throw std::invalid_argument("tabsToSpaces: tab stops must be positive and ascending");
+                }
+            }
+
+            if (tabStops.tailMode != TabStopTail::None && tabStops.tail < 1) {
+                throw std::invalid_argument("tabsToSpaces: tab stop tail must be greater than zero");
+            }
+        }
+
+        [[nodiscard]] constexpr bool reindents(Config const& config) noexcept
+        {
+            return config.targetIndent != 0;
+        }
+
+        constexpr void checkIndent(Config const& config)
+        {
+            if (config.targetIndent < 0 || config.sourceIndent < 0
+             || (reindents(config) && config.sourceIndent == autoIndent)) {
+                throw std::invalid_argument("tabsToSpaces: indentation width must be greater than zero");
+            }
+        }
+
+        // Tabs every width columns.
+        struct UniformTabs
+        {
+            int width;
+
+            [[nodiscard]] constexpr auto maxSpaces() const noexcept
+                -> int
+            {
+                return width;
+            }
+
+            // Returns the number of spaces the tab at column expands to.
+            [[nodiscard]] constexpr auto tab(int& column) const noexcept
+                -> int
+            {
+                auto const spaces = width - column;
+                column = 0;
+                return spaces;
+            }
+
+            [[nodiscard]] constexpr auto stopDistance(int column) const noexcept
+                -> int
+            {
+                return width - column;
+            }
+
+            [[nodiscard]] constexpr bool hasStopAfter(int) const noexcept
+            {
+                return true;
+            }
+
+            constexpr void advance(int& column) const noexcept
+            {
+                if (++column == width) {
+                    column = 0;
+                }
+            }
+        };
+
+        // Tab stop list precomputed into a column to tab spaces lookup table.
+        // The columns past the table are periodic, so the column wraps from the table end to wrapFrom.
+        struct TabStopTable
+        {
+            std::vector<int> spaces;
+            int              wrapFrom   = 0;
+            int              endOfStops = 0; // no tab stops from this column on (the table size if periodic)
+
+            [[nodiscard]] constexpr auto maxSpaces() const noexcept
+                -> int
+            {
+                return std::ranges::max(spaces);
+            }
+
+            [[nodiscard]] constexpr auto tab(int& column) const noexcept
+                -> int
+            {
+                auto const tabSpaces = spaces[column];
+                column += tabSpaces;
+                if (column == static_cast<int>(spaces.size())) {
+                    column = wrapFrom;
+                }
+
+                return tabSpaces;
+            }
+
+            [[nodiscard]] constexpr auto stopDistance(int column) const noexcept
+                -> int
+            {
+                return spaces[column];
+            }
+
+            [[nodiscard]] constexpr bool hasStopAfter(int column) const noexcept
+            {
+                return column < endOfStops;
+            }
+
+            constexpr void advance(int& column) const noexcept
+            {
+                if (++column == static_cast<int>(spaces.size())) {
+                    column = wrapFrom;
+                }
+            }
+        };
+
+        [[nodiscard]] constexpr auto makeTabStopTable(TabStops const& tabStops)
+            -> TabStopTable
+        {
+            auto const last = tabStops.stops[tabStops.count - 1];
+            auto const tail = tabStops.tail;
+
+            int nextStop = 0; // the first stop past the explicit ones
+            int wrapFrom = 0;
+            switch (tabStops.tailMode) {
+            case TabStopTail::None:
+                nextStop = last + 1;
+                wrapFrom = last;
+                break;
+
+            case TabStopTail::Increment:
+                nextStop = last + tail;
+                wrapFrom = last;
+                break;
+
+            case TabStopTail::Multiple:
+                wrapFrom = (last + tail - 1) / tail * tail;
+                nextStop = wrapFrom + tail;
+                break;
+            }
+
+            TabStopTable table
+            {
+                .spaces     = std::vector<int>(nextStop),
+                .wrapFrom   = wrapFrom,
+                .endOfStops = tabStops.tailMode == TabStopTail::None ? last : nextStop
+            };
+
+            auto stop = tabStops.stops.begin();
+            auto const stopsEnd = stop + tabStops.count;
+            for (int column = 0; column < nextStop; ++column) {
+                while (stop != stopsEnd && *stop <= column) {
+                    ++stop;
+                }
+
+                if (stop != stopsEnd) {
+                    table.spaces[column] = *stop - column;
+                } else if (tabStops.tailMode == TabStopTail::None) {
+                    table.spaces[column] = 1;
+                } else if (column < wrapFrom) {
+                    table.spaces[column] = wrapFrom - column;
+                } else {
+                    table.spaces[column] = nextStop - column;
+                }
+            }
+
+            return table;
+        }
+
+        // Tab width used if auto detection finds no evidence.
+        inline constexpr int fallbackTabWidth = 4;
+
+        // Auto detection looks only at the beginning of the file.
+        inline constexpr std::size_t styleSampleSize = 64 * 1024;
+
+        // Count CR LF pairs. The loop is branchless to be auto-vectorized.
+        [[nodiscard]] constexpr auto countCrLf(std::string_view text) noexcept
+            -> std::size_t
+        {
+            std::size_t count = 0;
+            for (std::size_t i = 1; i < text.size(); ++i) {
+                count += (text[i - 1] == '\r') & (text[i] == '\n');
+            }
+
+            return count;
+        }
+
+        [[nodiscard]] constexpr auto detectLineEnding(std::string_view sample) noexcept
+            -> LineEndingMode
+        {
+            auto const lf   = static_cast<std::size_t>(std::ranges::count(sample, '\n'));
+            auto const crlf = countCrLf(sample);
+            auto const bare = lf - crlf;
+            return crlf > bare ? LineEndingMode::CrLf
+                 : bare > crlf ? LineEndingMode::Lf
+                 : LineEndingMode::Ignore;
+        }
+
+        // Guess the tab width from indentation: the most frequent indentation increase
+        // of space-indented lines is the indentation step. Spaces following leading tabs
+        // (e.g. GNU style) mean that tabs replace as many spaces as possible, so the tab width
+        // is the next multiple of the step above any indentation made of spaces.
+        [[nodiscard]] constexpr auto detectTabWidth(std::string_view sample) noexcept
+            -> int
+        {
+            constexpr int maxStep = 8;
+
+            int  steps[maxStep + 1] {};
+            int  previousIndent       = 0;
+            bool previousKnown        = true;
+            int  maxSpacesAfterTabs   = 0;
+            int  maxSpaces            = 0;
+
+            while (!sample.empty()) {
+                auto const lf   = sample.find('\n');
+                auto const line = sample.substr(0, lf);
+                sample.remove_prefix(lf == sample.npos ? sample.size() : lf + 1);
+
+                auto const tabs   = std::min(line.find_first_not_of('\t'), line.size());
+                auto const indent = std::min(line.find_first_not_of(' ', tabs), line.size());
+                if (indent == line.size() || line[indent] == '\t' || line[indent] == '\r') {
+                    continue; // a blank line or unclear indentation
+                }
+
+                auto const spaces = static_cast<int>(indent - tabs);
+                if (tabs != 0) {
+                    maxSpacesAfterTabs = std::max(maxSpacesAfterTabs, spaces);
+                    previousKnown      = false;
+                    continue;
+                }
+
+                if (previousKnown && spaces > previousIndent && spaces - previousIndent <= maxStep) {
+                    ++steps[spaces - previousIndent];
+                }
+
+                previousIndent = spaces;
+                previousKnown  = true;
+                maxSpaces      = std::max(maxSpaces, spaces);
+            }
+
+            int step = 0;
+            for (int i = 1; i <= maxStep; ++i) {
+                if (steps[i] != 0 && steps[i] >= steps[step]) {
+                    step = i;
+                }
+            }
+
+            if (maxSpacesAfterTabs != 0) {
+                auto const maxIndent = std::max(maxSpacesAfterTabs, maxSpaces);
+                return step == 0 ? 8 : (maxIndent / step + 1) * step;
+            }
+
+            return step == 0 ? fallbackTabWidth : step;
+        }
+
+        // Columns taken by the blanks [from, to) beginning a line.
+        template <typename Tabs>
+        [[nodiscard]] constexpr auto measureIndent(
+                char const*     from,
+                char const*     to,
+                Tabs const&     tabs
+            ) noexcept -> int
+        {
+            int column = 0;
+            int indent = 0;
+            for (; from != to; ++from) {
+                if (*from == '\t') {
+                    indent += tabs.tab(column);
+                } else {
+                    tabs.advance(column);
+                    ++indent;
+                }
+            }
+
+            return indent;
+        }
+
+        // Guess the indentation unit: the most frequent indentation increase in columns
+        // (tabs expanded). Returns 0 if there is no evidence.
+        template <typename Tabs>
+        [[nodiscard]] constexpr auto detectIndentUnit(
+                std::string_view    sample,
+                Tabs const&         tabs
+            ) noexcept -> int
+        {
+            constexpr int maxStep = 8;
+
+            int steps[maxStep + 1] {};
+            int previousIndent = 0;
+
+            while (!sample.empty()) {
+                auto const lf   = sample.find('\n');
+                auto const line = sample.substr(0, lf);
+                sample.remove_prefix(lf == sample.npos ? sample.size() : lf + 1);
+
+                auto const blanks = std::min(line.find_first_not_of(" \t"), line.size());
+                if (blanks == line.size() || line[blanks] == '\r') {
+                    continue; // a blank line
+                }
+
+                auto const indent = measureIndent(line.data(), line.data() + blanks, tabs);
+                if (indent > previousIndent && indent - previousIndent <= maxStep) {
+                    ++steps[indent - previousIndent];
+                }
+
+                previousIndent = indent;
+            }
+
+            int step = 0;
+            for (int i = 1; i <= maxStep; ++i) {
+                if (steps[i] != 0 && steps[i] >= steps[step]) {
+                    step = i;
+                }
+            }
+
+            return step;
+        }
+
+        [[nodiscard]] constexpr bool detectsStyle(Config const& config) noexcept
+        {
+            return config.lineEndingMode == LineEndingMode::Auto
+                || (config.tabStops.count == 0 && config.tabWidth == autoTabWidth)
+                || (reindents(config) && config.sourceIndent == autoIndent);
+        }
+
+        // Resolve automatic tab width and line ending mode by a sample of text.
+        [[nodiscard]] constexpr auto detectStyle(
+                std::string_view    text,
+                Config              config
+            ) -> Config
+        {
+            auto const sample = text.substr(0, styleSampleSize);
+            if (config.lineEndingMode == LineEndingMode::Auto) {
+                config.lineEndingMode = detectLineEnding(sample);
+            }
+
+            if (config.tabStops.count == 0 && config.tabWidth == autoTabWidth) {
+                config.tabWidth = detectTabWidth(sample);
+            }
+
+            if (reindents(config) && config.sourceIndent == autoIndent) {
+                int unit = 0;
+                if (config.tabStops.count == 0) {
+                    unit = detectIndentUnit(sample, UniformTabs{ config.tabWidth });
+                } else {
+                    checkTabWidth(config);
+                    unit = detectIndentUnit(sample, makeTabStopTable(config.tabStops));
+                }
+
+                config.sourceIndent = unit != 0 ? unit : config.targetIndent; // no evidence: keep
+            }
+
+            return config;
+        }
+
+        inline constexpr std::string_view utf8ByteOrderMark = "\xEF\xBB\xBF";
+        inline constexpr std::string_view lineSpaces        = " \t\r\n";
+
+        // The first new-line sequence found in text or an empty string.
+        [[nodiscard]] constexpr auto newlineIn(std::string_view text) noexcept
+            -> std::string_view
+        {
+            auto const lf = text.find('\n');
+            if (lf == text.npos) {
+                return {};
+            }
+
+            return lf != 0 && text[lf - 1] == '\r' ? "\r\n" : "\n";
+        }
+
+        // The new-line sequence appended to ensure the final new-line.
+        [[nodiscard]] constexpr auto finalNewline(
+                LineEndingMode      lineEndingMode,
+                std::string_view    detected
+            ) noexcept -> std::string_view
+        {
+            switch (lineEndingMode) {
+            case LineEndingMode::Lf:   return "\n";
+            case LineEndingMode::CrLf: return "\r\n";
+            default:                   return detected.empty() ? "\n" : detected;
+            }
+        }
+
+        // Are there end-of-file transforms needing the output tail?
+        [[nodiscard]] constexpr bool transformsTail(Config const& config) noexcept
+        {
+            return config.finalNewline       == FinalNewline::Ensure
+                || config.trailingBlankLines == TrailingBlankLines::Delete;
+        }
+
+        // Apply end-of-file transforms to tail, the whitespace run ending the output.
+        // hasContent tells whether there are non-whitespace characters before tail.
+        constexpr void finishTail(
+                std::string&        tail,
+                bool                hasContent,
+                std::string_view    newline,
+                Config const&       config
+            )
+        {
+            if (config.trailingBlankLines == TrailingBlankLines::Delete) {
+                if (!hasContent) {
+                    tail.clear();
+                } else if (auto const lf = tail.find('\n'); lf != tail.npos) {
+                    tail.resize(lf + 1);
+                }
+            }
+
+            if (config.finalNewline == FinalNewline::Ensure
+             && (hasContent || !tail.empty()) && !tail.ends_with('\n')) {
+                tail += newline;
+            }
+        }
+
+        // Apply end-of-file transforms to the whole output, a std::string or any buffer
+        // with data(), size() and resize() keeping the contents.
+        template <typename Output>
+        constexpr void finishOutput(
+                Output&             output,
+                Config const&       config
+            )
+        {
+            std::string_view const text{ output.data(), output.size() };
+
+            auto const content    = text.find_last_not_of(lineSpaces);
+            bool const hasContent = content != text.npos;
+            auto const tailStart  = hasContent ? content + 1 : 0;
+
+            std::string tail{ text.substr(tailStart) };
+            finishTail(tail, hasContent, finalNewline(config.lineEndingMode, newlineIn(text)), config);
+            output.resize(tailStart + tail.size());
+            std::ranges::copy(tail, output.data() + tailStart);
+        }
+
+        // Call function with NoRegions or TabRegions according to config.
+        template <typename Function>
+        constexpr decltype(auto) withRegions(
+                Config const&   config,
+                Function&&      function
+            )
+        {
+            if (config.tabProtection == TabProtection::None
+             || config.tabProtection == TabProtection::Auto) {
+                NoRegions regions;
+                return function(regions);
+            }
+
+            TabRegions regions{ config.tabProtection };
+            return function(regions);
+        }
+
+        // Call function with UniformTabs or TabStopTable according to config.
+        template <typename Function>
+        constexpr decltype(auto) withTabs(
+                Config const&   config,
+                Function&&      function
+            )
+        {
+            if (config.tabStops.count == 0) {
+                return function(UniformTabs{ config.tabWidth });
+            }
+
+            return function(makeTabStopTable(config.tabStops));
+        }
+
+        // Write the indentation of the line start blanks [read, readEnd) rescaled
+        // from config.sourceIndent to config.targetIndent columns per level, the rest kept.
+        // The result is made of spaces, or of tabs at the tab stops it reaches and spaces if useTabs.
+        template <typename Tabs>
+        [[nodiscard]] constexpr auto writeIndent(
+                char const*     read,
+                char const*     readEnd,
+                char*           write,
+                Config const&   config,
+                Tabs const&     tabs,
+                int&            column,
+                bool            useTabs
+            ) -> char*
+        {
+            auto const indent = measureIndent(read, readEnd, tabs);
+            auto const target = indent / config.sourceIndent * config.targetIndent
+                              + indent % config.sourceIndent;
+
+            column = 0;
+            for (int done = 0; done < target;) {
+                if (useTabs && tabs.hasStopAfter(column) && tabs.stopDistance(column) <= target - done) {
+                    done += tabs.tab(column);
+                    *write++ = '\t';
+                } else {
+                    tabs.advance(column);
+                    ++done;
+                    *write++ = ' ';
+                }
+            }
+
+            return write;
+        }
+
+        // Upper bound of the output size for text.
+        template <typename Tabs>
+        [[nodiscard]] constexpr auto estimateConvertedSize(
+                std::string_view    text,
+                Config const&       config,
+                Tabs const&         tabs
+            ) -> std::size_t
+        {
+            if (!reindents(config)) {
+                // Conversion to tabs never makes blanks longer.
+                return estimateOutputSize(text,
+                        config.conversion == Conversion::TabsToSpaces ? tabs.maxSpaces() : 0);
+            }
+
+            auto const scale = (config.targetIndent + config.sourceIndent - 1) / config.sourceIndent;
+            return estimateOutputSize(text, tabs.maxSpaces()) * std::max(scale, 1);
+        }
+
+        // Upper bound of the output size for any text of size bytes, found without reading it:
+        // estimateConvertedSize as if each byte were a tab or a new-line, whichever grows more.
+        template <typename Tabs>
+        [[nodiscard]] constexpr auto boundConvertedSize(
+                std::size_t         size,
+                Config const&       config,
+                Tabs const&         tabs
+            ) -> std::size_t
+        {
+            bool const reindent = reindents(config);
+            auto const spaces   = reindent || config.conversion == Conversion::TabsToSpaces ? tabs.maxSpaces() : 0;
+            auto const scale    = reindent ? (config.targetIndent + config.sourceIndent - 1) / config.sourceIndent : 1;
+            return size * static_cast<std::size_t>(1 + std::max(spaces, 1)) * static_cast<std::size_t>(std::max(scale, 1));
+        }
+
+        // Convert bytes of [read, readEnd) writing them from write on.
+        // Column and pending CR are carried in and out through column and hasCr.
+        // If more input is to follow (last is false), stops before a trailing whitespace run
+        // that may precede a newline. Returns the positions where reading and writing stopped.
+        // Tabs protected by regions are copied intact.
+        // If re-indenting, leading tells whether the leading blanks of the line are yet to come.
+        template <typename Tabs, typename Regions>
+        [[nodiscard]] constexpr auto convertRange(
+                char const*     read,
+                char const*     readEnd,
+                char*           write,
+                Config const&   config,
+                Tabs const&     tabs,
+                Regions&        regions,
+                int&            column,
+                bool&           hasCr,
+                bool&           leading,
+                bool            last
+            ) -> std::pair<char const*, char*>
+        {
+            bool const tabIsSpace = regions.tabIsSpace();
+            regions.start(read);
+
+            auto const lineEndingMode = config.lineEndingMode;
+
+            bool const trim     = config.whitespaceBeforeNewLines == WhitespaceBeforeNewLines::Trim;
+            bool const lf       = lineEndingMode == LineEndingMode::Lf;
+            bool const crlf     = lineEndingMode == LineEndingMode::CrLf;
+            bool const reindent = reindents(config);
+
+            bool atLineStart = leading; // kept local as writes through char* may alias it
+            while (read != readEnd) {
+                if (reindent && atLineStart && (*read == ' ' || *read == '\t')) {
+                    if (trim) {
+                        if (auto nlPos = newlineProbe(read, readEnd, lineEndingMode, tabIsSpace)) {
+                            if (!last && nlPos == readEnd) {
+                                break;
+                            }
+
+                            read = nlPos; // a blank line
+                            continue;
+                        }
+                    }
+
+                    auto const runEnd = std::ranges::find_if(read, readEnd,
+                            [](char ch) { return ch != ' ' && ch != '\t'; });
+
+                    if (!last && runEnd == readEnd) {
+                        break; // its width depends on what follows
+                    }
+
+                    atLineStart = false;
+                    if (!regions.protectsBlanks(read, true)) {
+                        write = writeIndent(read, runEnd, write, config, tabs, column, false);
+                        read  = runEnd;
+                        continue;
+                    }
+                }
+
+                switch (auto const in = *read++) {
+                case '\t':
+                    if (regions.protects(read - 1)) {
+                        if (lf && hasCr) {
+                            *write++ = '\r';
+                        }
+
+                        *write++ = in;
+                        [[maybe_unused]] auto const spaces = tabs.tab(column);
+                        hasCr = false;
+                        break;
+                    }
+
+                    if (trim) {
+                        if (auto nlPos = newlineProbe(read - 1, readEnd, lineEndingMode, tabIsSpace)) {
+                            if (!last && nlPos == readEnd) {
+                                regions.stop(read - 1);
+                                leading = atLineStart;
+                                return { read - 1, write };
+                            }
+
+                            read = nlPos;
+                            continue;
+                        }
+                    }
+
+                    if (lf && hasCr) {
+                        *write++ = '\r';
+                    }
+
+                    write = std::fill_n(write, tabs.tab(column), ' ');
+                    hasCr = false;
+                    break;
+
+                case '\n':
+                    if (crlf && !hasCr) {
+                        *write++ = '\r';
+                    }
+
+                    *write++    = in;
+                    column      = 0;
+                    hasCr       = false;
+                    atLineStart = true;
+                    break;
+
+                default:
+                    if (trim && in == ' ') {
+                        if (auto nlPos = newlineProbe(read - 1, readEnd, lineEndingMode, tabIsSpace)) {
+                            if (!last && nlPos == readEnd) {
+                                regions.stop(read - 1);
+                                leading = atLineStart;
+                                return { read - 1, write };
+                            }
+
+                            read = nlPos;
+                            continue;
+                        }
+                    }
+
+                    if (lf && hasCr) {
+                        *write++ = '\r';
+                    } // else writes CR immediately.
+
+                    hasCr = in == '\r';
+                    if (!lf || !hasCr) {
+                        *write++ = in;
+                    } // else writes CR before the next character that is not LF.
+
+                    // CR and NUL are assumed to have zero width.
+                    if (in != '\0' && in != '\r') {
+                        tabs.advance(column);
+                    }
+
+                    atLineStart = atLineStart && in == ' ';
+                }
+            }
+
+            leading = atLineStart;
+
+            if (last && lf && hasCr) {
+                *write++ = '\r'; // a single CR at the end of input
+                hasCr    = false;
+            }
+
+            if (!last) {
+                regions.stop(read);
+            }
+
+            return { read, write };
+        }
+
+        // Convert blanks of [read, readEnd) into tabs where they reach tab stops following unexpand:
+        // a blank run reaching a tab stop is replaced by a tab, but a single space just before
+        // a tab stop is kept unless more blanks follow it or it begins the line. Past the last stop of a tab stop list
+        // the rest of the line is kept. Leading tells whether the line has had only blanks so far.
+        // New-lines, trimming, regions and stopping before a trailing blank run if more input
+        // is to follow and re-indentation are the same as in convertRange.
+        template <typename Tabs, typename Regions>
+        [[nodiscard]] constexpr auto unexpandRange(
+                char const*     read,
+                char const*     readEnd,
+                char*           write,
+                Config const&   config,
+                Tabs const&     tabs,
+                Regions&        regions,
+                int&            column,
+                bool&           hasCr,
+                bool&           leading,
+                bool            last
+            ) -> std::pair<char const*, char*>
+        {
+            bool const tabIsSpace = regions.tabIsSpace();
+            regions.start(read);
+
+            auto const lineEndingMode = config.lineEndingMode;
+
+            bool const trim      = config.whitespaceBeforeNewLines == WhitespaceBeforeNewLines::Trim;
+            bool const lf        = lineEndingMode == LineEndingMode::Lf;
+            bool const crlf      = lineEndingMode == LineEndingMode::CrLf;
+            bool const allBlanks = config.conversion == Conversion::SpacesToTabs;
+            bool const reindent  = reindents(config);
+
+            auto const copyBlanks = [&](char const* from, char const* to)
+                {
+                    for (; from != to; ++from) {
+                        if (*from == '\t') {
+                            [[maybe_unused]] auto const spaces = tabs.tab(column);
+                        } else {
+                            tabs.advance(column);
+                        }
+
+                        *write++ = *from;
+                    }
+                };
+
+            while (read != readEnd) {
+                switch (auto const in = *read) {
+                case ' ':
+                case '\t': {
+                    if (trim) {
+                        if (auto nlPos = newlineProbe(read, readEnd, lineEndingMode, tabIsSpace)) {
+                            if (!last && nlPos == readEnd) {
+                                regions.stop(read);
+                                return { read, write };
+                            }
+
+                            read = nlPos;
+                            continue;
+                        }
+                    }
+
+                    auto const runEnd = std::ranges::find_if(read, readEnd,
+                            [](char ch) { return ch != ' ' && ch != '\t'; });
+
+                    if (!last && runEnd == readEnd) {
+                        regions.stop(read);
+                        return { read, write }; // its tabs depend on what follows
+                    }
+
+                    if (lf && hasCr) {
+                        *write++ = '\r';
+                    }
+
+                    hasCr = false;
+
+                    if (reindent && leading && !regions.protectsBlanks(read, true)) {
+                        write = writeIndent(read, runEnd, write, config, tabs, column, true);
+                        read  = runEnd;
+                        break;
+                    }
+
+                    if (!(allBlanks || leading) || regions.protectsBlanks(read, leading)) {
+                        copyBlanks(read, runEnd);
+                        read = runEnd;
+                        break;
+                    }
+
+                    int  pending   = 0;       // spaces which may yet be replaced by a tab
+                    bool oneBlank  = false;   // the first pending space alone reaches a tab stop
+                    bool prevBlank = leading; // a line start counts as a blank
+                    for (; read != runEnd; ++read) {
+                        if (!tabs.hasStopAfter(column)) {
+                            break;
+                        }
+
+                        if (*read == '\t') {
+                            [[maybe_unused]] auto const spaces = tabs.tab(column);
+                        } else {
+                            bool const reachesStop = tabs.stopDistance(column) == 1;
+                            tabs.advance(column);
+                            if (!(prevBlank && reachesStop)) {
+                                oneBlank  = oneBlank || reachesStop;
+                                prevBlank = true;
+                                ++pending;
+                                continue;
+                            }
+                        }
+
+                        // Replace the pending spaces with a tab, or two if the first one reached a stop.
+                        if (pending != 0 && oneBlank) {
+                            *write++ = '\t';
+                        }
+
+                        *write++  = '\t';
+                        pending   = 0;
+                        oneBlank  = false;
+                        prevBlank = true;
+                    }
+
+                    if (pending > 1 && oneBlank) {
+                        *write++ = '\t';
+                        --pending;
+                    }
+
+                    write = std::fill_n(write, pending, ' ');
+                    copyBlanks(read, runEnd); // past the last tab stop
+                    read = runEnd;
+                    break;
+                }
+
+                case '\n':
+                    if (crlf && !hasCr) {
+                        *write++ = '\r';
+                    }
+
+                    *write++ = in;
+                    ++read;
+                    column   = 0;
+                    hasCr    = false;
+                    leading  = true;
+                    break;
+
+                default:
+                    if (lf && hasCr) {
+                        *write++ = '\r';
+                    } // else writes CR immediately.
+
+                    hasCr = in == '\r';
+                    if (!lf || !hasCr) {
+                        *write++ = in;
+                    } // else writes CR before the next character that is not LF.
+
+                    // CR and NUL are assumed to have zero width.
+                    if (in != '\0' && in != '\r') {
+                        tabs.advance(column);
+                    }
+
+                    ++read;
+                    leading = false;
+                }
+            }
+
+            if (last && lf && hasCr) {
+                *write++ = '\r'; // a single CR at the end of input
+                hasCr    = false;
+            }
+
+            if (!last) {
+                regions.stop(read);
+            }
+
+            return { read, write };
+        }
+
+        // Inputs from this size on are converted with non-temporal stores: an output this large
+        // is not read back soon, so writing it through the caches would only evict everything.
+        inline constexpr std::size_t streamingInputSize = std::size_t{64} << 20;
+
+        // Input converted at a time into a staging buffer small enough to stay in the cache.
+        inline constexpr std::size_t streamingPieceSize = std::size_t{16} << 10;
+
+        // Copy with non-temporal stores (SSE2), an ordinary copy on other processors.
+        // Defined in tabs_to_spaces.cpp like the other non-constexpr helpers below.
+        void streamCopy(
+                char*           to,
+                char const*     from,
+                std::size_t     size
+            ) noexcept;
+
+        // Order the non-temporal stores before the stores that follow.
+        void streamFence() noexcept;
+
+        // Hint to fetch the bytes ahead, not to be kept in the caches.
+        void prefetchInput(
+                char const*     data,
+                std::size_t     size
+            ) noexcept;
+
+        // Convert [read, readEnd) like convertRange as the last input, piece by piece through
+        // the staging buffer copied out with non-temporal stores, while the next piece is
+        // prefetched. Returns where writing stopped.
+        template <typename Tabs, typename Regions>
+        [[nodiscard]] auto convertStreaming(
+                char const*     read,
+                char const*     readEnd,
+                char*           write,
+                Config const&   config,
+                Tabs const&     tabs,
+                Regions&        regions
+            ) -> char*
+        {
+            bool const expands = config.conversion == Conversion::TabsToSpaces;
+
+            int  column  = 0;
+            bool hasCr   = false;
+            bool leading = true;
+
+            auto const pieceAfter = [readEnd](char const* start)
+                {
+                    return start + std::min<std::size_t>(readEnd - start, streamingPieceSize);
+                };
+
+            // Sized once for any piece: counting the tabs and new-lines of each piece
+            // would read it twice and cost more than the streaming stores save.
+            std::string staging(boundConvertedSize(streamingPieceSize, config, tabs)
+                + 1, '\0'); // a pending CR from the previous piece
+
+            for (auto pieceEnd = pieceAfter(read); ; ) {
+                bool const last = pieceEnd == readEnd;
+                prefetchInput(pieceEnd, pieceAfter(pieceEnd) - pieceEnd);
+
+                // A piece stretched over a long whitespace run is written in place, not staged.
+                bool const staged = static_cast<std::size_t>(pieceEnd - read) <= streamingPieceSize;
+                char*      out    = staged ? staging.data() : write;
+
+                auto const [readStop, writeStop] = expands
+                    ? convertRange(
+                        read, pieceEnd, out, config, tabs, regions, column, hasCr, leading, last)
+                    : unexpandRange(
+                        read, pieceEnd, out, config, tabs, regions, column, hasCr, leading, last);
+
+                if (staged) {
+                    streamCopy(write, out, static_cast<std::size_t>(writeStop - out));
+                }
+
+                write += writeStop - out;
+                if (last) {
+                    break;
+                }
+
+                // A whitespace run up to the end of the piece waits for the input resolving it:
+                // the next piece reaches the first character after the run, as in Converter,
+                // so the run is converted once more and not again for every piece it spans.
+                auto next = pieceAfter(readStop);
+                if (readStop != pieceEnd) {
+                    auto const resolved = std::find_if(pieceEnd, readEnd,
+                            [](char ch) { return ch != ' ' && ch != '\t' && ch != '\r'; });
+                    next = std::max(next, resolved == readEnd ? readEnd : resolved + 1);
+                }
+
+                pieceEnd = next;
+                read     = readStop;
+            }
+
+            streamFence();
+            return write;
+        }
+
+        // Convert the whole file into output (empty), sized to the estimate first and then
+        // to the result. Output is a std::string or any buffer like for finishOutput.
+        template <typename Output>
+        constexpr void convertText(
+                std::string_view    file,
+                Config              config,
+                Output&             output
+            )
+        {
+            if (detectsStyle(config)) {
+                config = detectStyle(file, config);
+            }
+
+            checkTabWidth(config);
+            checkIndent(config);
+
+            if (config.byteOrderMark == ByteOrderMark::Strip && file.starts_with(utf8ByteOrderMark)) {
+                file.remove_prefix(utf8ByteOrderMark.size());
+            }
+
+            withTabs(config, [&](auto const& tabs)
+                {
+                    withRegions(config, [&](auto& regions)
+                        {
+                            bool const expands = config.conversion == Conversion::TabsToSpaces;
+                            output.resize(estimateConvertedSize(file, config, tabs));
+
+                            int  column  = 0;
+                            bool hasCr   = false;
+                            bool leading = true;
+
+                            auto const read  = file.data();
+                            auto const write = output.data();
+                            char*      end   = nullptr;
+                            if (!std::is_constant_evaluated() && file.size() >= streamingInputSize) {
+                                end = convertStreaming(read, read + file.size(), write, config, tabs, regions);
+                            } else {
+                                end = expands
+                                    ? convertRange(
+                                        read, read + file.size(), write,
+                                        config, tabs, regions, column, hasCr, leading, true).second
+                                    : unexpandRange(
+                                        read, read + file.size(), write,
+                                        config, tabs, regions, column, hasCr, leading, true).second;
+                            }
+
+                        #ifdef  TABS_TO_SPACES_TEST_ENABLED
+                            if (static_cast<std::size_t>(end - write) > output.size()) {
+                                throw std::logic_error("tabsToSpaces: invalid output size estimate detected");
+                            }
+                        #endif//TABS_TO_SPACES_TEST_ENABLED
+
+                            output.resize(end - write);
+                        });
+                });
+
+            // The other transforms touch only the ends of the text and take no additional pass.
+            if (transformsTail(config)) {
+                finishOutput(output, config);
+            }
+        }
+
+    }
+
+    [[nodiscard]] constexpr auto tabsToSpaces(
             std::string_view file,
             Config           config = {}
-        ) -> std::string;
+        ) -> std::string
+    {
+        std::string output;
+        Kernel::convertText(file, config, output);
+        return output;
+    }
+
+    // A string literal usable as a template argument.
+    template <std::size_t N>
+    struct StringLiteral
+    {
+        char data[N] {};
+
+        consteval StringLiteral(char const (&text)[N])
+        {
+            std::ranges::copy(text, data);
+        }
+
+        [[nodiscard]] constexpr auto view() const noexcept
+            -> std::string_view
+        {
+            return { data, N - 1 };
+        }
+    };
+
+    // Convert text at compile time, e.g. tabsToSpacesArray<"\tHelp text\n">().
+    // The result holds exactly the converted bytes without a terminating NUL.
+    template <StringLiteral text, Config config = Config{}>
+    [[nodiscard]] consteval auto tabsToSpacesArray()
+        -> std::array<char, tabsToSpaces(text.view(), config).size()>
+    {
+        std::array<char, tabsToSpaces(text.view(), config).size()> result {};
+        std::ranges::copy(tabsToSpaces(text.view(), config), result.begin());
+        return result;
+    }
+
+    // Set tab width from "n" or from a tab stop list in expand -t syntax:
+    // "4,8,20", "4,8,+8" (then every 8 columns), "4,8,/8" (then at multiples of 8).
+    // "auto" detects the tab width for each file.
+    [[nodiscard]] auto parseTabWidth(
+            std::string_view spec,
+            Config           config
+        ) -> Config;
+
+    // Set re-indentation from "to" (the source indentation unit is detected for each file)
+    // or "from:to" in columns per indentation level. "0" disables re-indentation.
+    [[nodiscard]] auto parseReindent(
+            std::string_view spec,
+            Config           config
+        ) -> Config;
+
+    // Converts input split into consecutive chunks carrying the state across them.
+    class Converter
+    {
+    public:
+        explicit Converter(Config config = {});
+
+        // Convert the next chunk appending the result to output.
+        void convert(
+                std::string_view chunk,
+                std::string&     output
+            );
+
+        // Flush the state after the last chunk. The converter may be reused afterwards.
+        void finish(std::string& output);
+
+    private:
+        Config               requested_;    // as given, with automatic settings
+        Config               config_;       // automatic settings resolved
+        Kernel::TabStopTable tabStopTable_; // used if config_.tabStops is not empty
+        Kernel::TabRegions   tabRegions_;   // used if config_.tabProtection is not None
+        int                  column_  = 0;
+        bool                 hasCr_   = false;
+        bool                 leading_ = true;   // at the leading blanks of a line
+        std::string          pending_; // whitespace run at the end of the previous chunk
+        std::string          sample_;  // input buffered to detect the style
+        bool                 detecting_  = false;
+        std::string          head_;    // input which may yet turn out to be a BOM
+        bool                 headDone_   = false;
+        std::string          held_;    // whitespace run ending the output so far
+        bool                 hasContent_ = false;
+        std::string_view     newline_;
+
+        void start(std::string_view sample);
+
+        void convertUnbuffered(
+                std::string_view chunk,
+                std::string&     output
+            );
+
+        void convertChunk(
+                std::string_view chunk,
+                std::string&     output
+            );
+
+        void holdTail(
+                std::string&     output,
+                std::size_t      appendStart
+            );
+
+        auto convertPart(
+                std::string_view part,
+                std::string&     output,
+                bool             last
+            ) -> std::string_view;
+    };
+
+    // Convert text given as a range of string_view segments (e.g. rope or piece table chunks).
+    template <std::ranges::input_range Segments>
+        requires std::convertible_to<std::ranges::range_reference_t<Segments>, std::string_view>
+    [[nodiscard]] auto tabsToSpaces(
+            Segments&&  segments,
+            Config      config = {}
+        ) -> std::string
+    {
+        Converter   converter(config);
+        std::string output;
+        for (std::string_view segment : segments) {
+            converter.convert(segment, output);
+        }
+
+        converter.finish(output);
+        return output;
+    }
+
+    // An edit applied to a buffer: replace length bytes at offset with replacement.
+    struct TextEdit
+    {
+        std::size_t      offset      = 0;
+        std::size_t      length      = 0;
+        std::string_view replacement;
+    };
+
+    // A replacement to be applied to the converted buffer.
+    struct TextReplacement
+    {
+        std::size_t offset = 0;
+        std::size_t length = 0;
+        std::string text;
+    };
+
+    // Reconvert only the lines of an already converted buffer that the edit touches.
+    // With tab protection the buffer is scanned from its start for the state of the protection,
+    // and the lines before and after the edit are reconverted as far as that state needs.
+    // Applying the result to converted gives the same text as converting
+    // the whole edited buffer with the same config.
+    [[nodiscard]] auto reconvertEdit(
+            std::string_view converted,
+            TextEdit         edit,
+            Config           config = {}
+        ) -> TextReplacement;
+
+    // Choose tab protection by file name (for TabProtection::Auto).
+    [[nodiscard]] auto detectTabProtection(std::filesystem::path const& filename)
+        -> TabProtection;
 
     void tabsToSpaces(
             std::filesystem::path const& path,
             Config                       config = {}
         );
 
+    enum class CompressedFiles
+    {
+        AsIs,       // process as any other file
+        Stream,     // gzip and zstd files (detected by magic bytes) are decompressed, converted
+                    // and compressed back in the same format by streaming
+    };
+
+    class FileSystem;
+    class Transaction;
+    class Stats;
+    class LargeBufferPool;
+
+    enum class CleanMarkers
+    {
+        Ignore,
+        Use,        // skip files marked clean for the config, mark the results clean
+    };
+
+    // Name of the extended attribute marking a file clean.
+    inline constexpr std::string_view cleanMarkerAttribute = "user.tabs2spaces";
+
+    // Options of processing files (as opposed to converting the text).
+    struct FileOptions
+    {
+        // If not empty, the input is left intact and the results are written into this directory
+        // mirroring the input tree: under the path relative to the current directory
+        // (or the absolute path without its root for files outside the current directory).
+        std::filesystem::path   outputDirectory;
+
+        CompressedFiles         compressedFiles = CompressedFiles::AsIs;
+
+        // Where the files are read and written, the native file system if null.
+        FileSystem*             fileSystem      = nullptr;
+
+        // If not null, the files are left intact and unified diffs of the changes
+        // the conversion would make are written here instead.
+        std::ostream*           diff            = nullptr;
+
+        // If Use, a file whose attribute records the config, modification time and size it has
+        // is not read, the results of the conversion get such attributes. Not used with diff
+        // or an output directory.
+        CleanMarkers            cleanMarkers    = CleanMarkers::Ignore;
+
+        // If not null, the files are saved into it before they are replaced or created,
+        // and its directory is not walked.
+        Transaction*            transaction     = nullptr;
+
+        // If not null, the latencies of the phases and the time of each file are recorded here.
+        Stats*                  stats           = nullptr;
+
+        // If not null, large outputs of files converted whole (diffed ones, as the others
+        // of that size are converted in chunks) are written into mappings of this pool.
+        LargeBufferPool*        largeBuffers    = nullptr;
+    };
+
+    // The same, adding the result of every processed file to the report.
+    void tabsToSpaces(
+            std::filesystem::path const& path,
+            Config                       config,
+            Report&                      report,
+            FileOptions const&           options = {}
+        );
+
+    // Call process for the file or, if the file name part of the path has wildcards (* and ?),
+    // for each regular file matching it in the directory (and its subdirectories if walk is Nested,
+    // except skipDirectories; empty paths among them are ignored).
+    void forEachMatchingFile(
+            FileSystem&                                             files,
+            std::filesystem::path const&                            path,
+            DirectoryWalk                                           walk,
+            std::function<void(std::filesystem::path const&)> const& process,
+            std::span<std::filesystem::path const>                  skipDirectories = {}
+        );
+
 #ifdef  TABS_TO_SPACES_TEST_ENABLED
     int test_tabsToSpaces();
 #endif//TABS_TO_SPACES_TEST_ENABLED
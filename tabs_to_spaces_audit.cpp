@@ -0,0 +1,233 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_audit.hpp"
+#include "tabs_to_spaces_file_system.hpp"
+#include "tabs_to_spaces_report.hpp"
+
+#include <atomic>
+#include <thread>
+#include <exception>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+    namespace fs = std::filesystem;
+
+    namespace
+    {
+
+        void writeCounts(
+                std::ostream&           os,
+                WhitespaceCounts const& counts
+            )
+        {
+            os << ", \"bytes\": "sv              << counts.bytes
+               << ", \"lines\": "sv              << counts.lines
+               << ", \"tabs\": "sv               << counts.tabs()
+               << ", \"indentTabs\": "sv         << counts.indentTabs
+               << ", \"alignTabs\": "sv          << counts.alignTabs
+               << ", \"crlf\": "sv               << counts.crlf
+               << ", \"lf\": "sv                 << counts.lf
+               << ", \"loneCr\": "sv             << counts.loneCr
+               << ", \"trailingWhitespace\": "sv << counts.trailingWhitespace
+               << ", \"mixedIndent\": "sv        << counts.mixedIndent;
+        }
+
+    }
+
+    Audit::Audit(FileSystem* fileSystem) noexcept
+        : fileSystem_(fileSystem != nullptr ? *fileSystem : nativeFileSystem())
+    {
+    }
+
+    void Audit::add(
+            fs::path const& path,
+            DirectoryWalk   walk
+        )
+    {
+        forEachMatchingFile(fileSystem_, path, walk, [this](fs::path const& filename)
+            {
+                files_.push_back({ filename, {}, {} });
+            });
+    }
+
+    void Audit::scan(unsigned threads)
+    {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // Workers take the files one by one, so large files do not hold up the others.
+        std::atomic<std::size_t> next = scanned_;
+        auto const worker = [this, &next]
+            {
+                for (auto i = next++; i < files_.size(); i = next++) {
+                    auto& file = files_[i];
+                    try {
+                        file.counts = countWhitespace(fileSystem_.read(file.path));
+                    } catch (std::exception const& e) {
+                        file.error = e.what();
+                    }
+                }
+            };
+
+        {
+            std::vector<std::jthread> helpers;
+            for (auto pending = files_.size() - scanned_; helpers.size() + 1 < std::min<std::size_t>(threads, pending); ) {
+                helpers.emplace_back(worker);
+            }
+
+            worker();
+        }
+
+        for (; scanned_ < files_.size(); ++scanned_) {
+            auto const& file = files_[scanned_];
+            if (!file.error.empty()) {
+                continue;
+            }
+
+            for (auto directory = file.path.parent_path().lexically_normal(); ; directory = directory.parent_path()) {
+                if (directory.empty()) {
+                    directory = ".";
+                }
+
+                auto& rollup = directories_[directory];
+                ++rollup.files;
+                rollup.counts += file.counts;
+
+                // Up to the root, the current directory or the parent (..) one.
+                if (directory == directory.parent_path() || directory == "." || directory.filename() == "..") {
+                    break;
+                }
+            }
+        }
+    }
+
+    void Audit::writeJson(std::ostream& os) const
+    {
+        os << "{\n  \"files\": ["sv;
+
+        char const* separator = "\n";
+        for (auto const& file : files_) {
+            os << separator << "    { \"path\": "sv << JsonString{ toUtf8(file.path) };
+            if (file.error.empty()) {
+                writeCounts(os, file.counts);
+            } else {
+                os << ", \"error\": "sv << JsonString{ file.error };
+            }
+
+            os << " }"sv;
+            separator = ",\n";
+        }
+
+        os << "\n  ],\n  \"directories\": ["sv;
+
+        separator = "\n";
+        for (auto const& [path, directory] : directories_) {
+            os << separator
+               << "    { \"path\": "sv  << JsonString{ toUtf8(path) }
+               << ", \"files\": "sv     << directory.files;
+            writeCounts(os, directory.counts);
+            os << " }"sv;
+            separator = ",\n";
+        }
+
+        os << "\n  ]\n}\n"sv;
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_audit()
+    {
+        int errors = 0;
+
+        static_assert(countWhitespace("\tx\ty \n"sv).alignTabs == 1);
+
+        struct
+        {
+            std::string_view    text;
+            WhitespaceCounts    counts;
+        } const tests[]
+        {
+            //                       bytes  lines  indent  align  crlf  lf  loneCr  trailing  mixed
+            { ""sv,                {     0,     0,      0,     0,    0,  0,      0,        0,     0 } },
+            { "x"sv,               {     1,     1,      0,     0,    0,  0,      0,        0,     0 } },
+            { "\tx\ty \n"sv,       {     6,     1,      1,     1,    0,  1,      0,        1,     0 } },
+            { " \tx\r\n\t\r\n"sv,  {     8,     2,      2,     0,    2,  0,      0,        1,     1 } },
+            { "a\rb\n\n  \t"sv,    {     8,     3,      1,     0,    0,  2,      1,        3,     1 } },
+        };
+
+        for (auto const& test : tests) {
+            if (countWhitespace(test.text) != test.counts) {
+                std::clog << "Test failed: countWhitespace("sv << std::quoted(test.text) << ")\n"sv;
+                ++errors;
+            }
+        }
+
+        static_assert(forEachViolation("a\tb \r\n\n  x"sv, [](LineViolation const&) {}) == 1);
+
+        {
+            std::vector<LineViolation> violations;
+            auto const lines = forEachViolation("ok\n\tx\ty \r\nz\r\n \t"sv,
+                [&violations](LineViolation const& violation) { violations.push_back(violation); });
+
+            auto matches = [&violations](std::size_t i, std::uint64_t line, std::size_t begin, std::size_t end, ViolationKind kind)
+                {
+                    auto const& v = violations[i];
+                    return v.line == line && v.begin == begin && v.end == end && v.kind == kind;
+                };
+
+            if (lines != 3 || violations.size() != 6
+             || !matches(0, 2,  3,  6, ViolationKind::Tab)
+             || !matches(1, 2,  7,  8, ViolationKind::TrailingWhitespace)
+             || !matches(2, 2,  8, 10, ViolationKind::CrLf)
+             || !matches(3, 3, 11, 13, ViolationKind::CrLf)
+             || !matches(4, 4, 14, 15, ViolationKind::Tab)
+             || !matches(5, 4, 13, 15, ViolationKind::TrailingWhitespace)) {
+                std::clog << "Test failed: forEachViolation\n"sv;
+                ++errors;
+            }
+        }
+
+        try {
+            MemoryFileSystem files;
+            files.addFile("src/a.c", "\tx\n");
+            files.addFile("src/sub/b.c", "  \ty \n");
+            files.addFile("src/c.txt", "\t\n");
+
+            Audit audit(&files);
+            audit.add("src/*.c", DirectoryWalk::Nested);
+            audit.add("src/missing.c", DirectoryWalk::Nested);
+            audit.add("./src/sub/b.c", DirectoryWalk::OneLevel);
+            audit.scan(2);
+
+            auto const& directories = audit.directories();
+            auto const src = directories.find("src");
+            auto const sub = directories.find("src/sub");
+            if (audit.files().size() != 4
+             || audit.files()[2].error.empty()
+             || directories.size() != 3
+             || src == directories.end() || src->second.files != 3 || src->second.counts.tabs() != 3
+             || src->second.counts.mixedIndent != 2 || src->second.counts.trailingWhitespace != 2
+             || sub == directories.end() || sub->second.files != 2
+             || directories.find(".")->second.counts != src->second.counts) {
+                std::clog << "Test failed: Audit\n"sv;
+                ++errors;
+            }
+        } catch (std::exception const& e) {
+            std::clog << "Test failed: Audit: "sv << e.what() << '\n';
+            ++errors;
+        }
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
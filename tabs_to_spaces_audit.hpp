@@ -0,0 +1,230 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_AUDIT_HPP
+#define TABS_TO_SPACES_AUDIT_HPP
+
+#include "tabs_to_spaces.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <filesystem>
+#include <ostream>
+#include <algorithm>
+#include <cstdint>
+
+namespace TabsToSpaces
+{
+
+    // Whitespace usage of a text. Lines end with LF or CR LF like for the conversion:
+    // a CR not followed by LF does not end a line.
+    struct WhitespaceCounts
+    {
+        std::uint64_t bytes              = 0;
+        std::uint64_t lines              = 0;
+        std::uint64_t indentTabs         = 0;   // tabs among the blanks beginning a line
+        std::uint64_t alignTabs          = 0;   // tabs after the first non-blank character of a line
+        std::uint64_t crlf               = 0;
+        std::uint64_t lf                 = 0;   // LF not preceded by CR
+        std::uint64_t loneCr             = 0;
+        std::uint64_t trailingWhitespace = 0;   // blank bytes ending lines (whole blank lines included)
+        std::uint64_t mixedIndent        = 0;   // lines beginning with both tabs and spaces
+
+        [[nodiscard]] constexpr auto tabs() const noexcept
+            -> std::uint64_t
+        {
+            return indentTabs + alignTabs;
+        }
+
+        constexpr auto operator+=(WhitespaceCounts const& other) noexcept
+            -> WhitespaceCounts&
+        {
+            bytes              += other.bytes;
+            lines              += other.lines;
+            indentTabs         += other.indentTabs;
+            alignTabs          += other.alignTabs;
+            crlf               += other.crlf;
+            lf                 += other.lf;
+            loneCr             += other.loneCr;
+            trailingWhitespace += other.trailingWhitespace;
+            mixedIndent        += other.mixedIndent;
+            return *this;
+        }
+
+        [[nodiscard]] constexpr bool operator==(WhitespaceCounts const&) const noexcept = default;
+    };
+
+    // Count in one pass without allocating. Line ends, tabs and CRs are searched with
+    // string_view::find which the standard library runs as a vectorized memchr.
+    [[nodiscard]] constexpr auto countWhitespace(std::string_view text) noexcept
+        -> WhitespaceCounts
+    {
+        constexpr std::string_view blanks = " \t";
+
+        WhitespaceCounts counts;
+        counts.bytes = text.size();
+
+        while (!text.empty()) {
+            auto const newline = text.find('\n');
+            auto line = text.substr(0, newline);
+            text.remove_prefix(newline == text.npos ? text.size() : newline + 1);
+            ++counts.lines;
+
+            if (newline != text.npos) {
+                if (line.ends_with('\r')) {
+                    line.remove_suffix(1);
+                    ++counts.crlf;
+                } else {
+                    ++counts.lf;
+                }
+            }
+
+            for (auto cr = line.find('\r'); cr != line.npos; cr = line.find('\r', cr + 1)) {
+                ++counts.loneCr;
+            }
+
+            auto const indentEnd = std::min(line.find_first_not_of(blanks), line.size());
+            auto const indentTabs = static_cast<std::uint64_t>(std::ranges::count(line.substr(0, indentEnd), '\t'));
+            counts.indentTabs += indentTabs;
+            if (indentTabs != 0 && indentTabs != indentEnd) {
+                ++counts.mixedIndent;
+            }
+
+            for (auto tab = line.find('\t', indentEnd); tab != line.npos; tab = line.find('\t', tab + 1)) {
+                ++counts.alignTabs;
+            }
+
+            auto const contentEnd = line.find_last_not_of(blanks);
+            counts.trailingWhitespace += line.size() - (contentEnd == line.npos ? 0 : contentEnd + 1);
+        }
+
+        return counts;
+    }
+
+    enum class ViolationKind
+    {
+        Tab,
+        TrailingWhitespace,     // blanks ending the line (a whole blank line included)
+        CrLf,
+    };
+
+    // A non-conformant line. The byte range, in offsets of the whole text, spans the first
+    // to the last tab of the line, the trailing blanks or the CR LF.
+    struct LineViolation
+    {
+        std::uint64_t   line  = 0;      // 1-based
+        std::size_t     begin = 0;
+        std::size_t     end   = 0;
+        ViolationKind   kind  = ViolationKind::Tab;
+    };
+
+    // Call visit(LineViolation const&) for each kind of violation of each line, in the order
+    // of the lines and then of the kinds, scanning like countWhitespace: no output is built
+    // and nothing is allocated. Returns the number of non-conformant lines.
+    template <typename Visit>
+    constexpr auto forEachViolation(
+            std::string_view    text,
+            Visit&&             visit
+        ) -> std::uint64_t
+    {
+        constexpr std::string_view blanks = " \t";
+
+        std::uint64_t violatingLines = 0;
+        std::uint64_t lineNumber     = 0;
+        for (std::size_t offset = 0; offset < text.size(); ) {
+            auto const newline = text.find('\n', offset);
+            auto line = text.substr(offset, (newline == text.npos ? text.size() : newline) - offset);
+            bool const crlf = newline != text.npos && line.ends_with('\r');
+            if (crlf) {
+                line.remove_suffix(1);
+            }
+
+            ++lineNumber;
+            bool violating = false;
+            auto const report = [&](std::size_t begin, std::size_t end, ViolationKind kind)
+                {
+                    visit(LineViolation{ lineNumber, offset + begin, offset + end, kind });
+                    violating = true;
+                };
+
+            if (auto const tab = line.find('\t'); tab != line.npos) {
+                report(tab, line.rfind('\t') + 1, ViolationKind::Tab);
+            }
+
+            auto const contentEnd = line.find_last_not_of(blanks);
+            if (auto const trailing = contentEnd == line.npos ? 0 : contentEnd + 1; trailing != line.size()) {
+                report(trailing, line.size(), ViolationKind::TrailingWhitespace);
+            }
+
+            if (crlf) {
+                report(line.size(), line.size() + 2, ViolationKind::CrLf);
+            }
+
+            violatingLines += violating ? 1 : 0;
+            offset = newline == text.npos ? text.size() : newline + 1;
+        }
+
+        return violatingLines;
+    }
+
+    struct AuditFile
+    {
+        std::filesystem::path   path;
+        WhitespaceCounts        counts;
+        std::string             error;      // not scanned if not empty
+    };
+
+    struct AuditDirectory
+    {
+        std::uint64_t           files = 0;
+        WhitespaceCounts        counts;
+    };
+
+    // Scan-only whitespace audit: counts per file rolled up into each directory containing it.
+    class Audit
+    {
+    public:
+        // Files are read from the native file system if fileSystem is null.
+        explicit Audit(FileSystem* fileSystem = nullptr) noexcept;
+
+        // Add the file or the files matching the wildcards of the path like for the conversion.
+        void add(
+                std::filesystem::path const&    path,
+                DirectoryWalk                   walk
+            );
+
+        // Scan the files added so far on threads (as many as the hardware runs if 0)
+        // and roll up the directories.
+        void scan(unsigned threads = 0);
+
+        [[nodiscard]] auto files() const noexcept
+            -> std::vector<AuditFile> const&
+        {
+            return files_;
+        }
+
+        // Relative paths are rolled up to ".".
+        [[nodiscard]] auto directories() const noexcept
+            -> std::map<std::filesystem::path, AuditDirectory> const&
+        {
+            return directories_;
+        }
+
+        void writeJson(std::ostream& os) const;
+
+    private:
+        FileSystem&                                         fileSystem_;
+        std::vector<AuditFile>                              files_;
+        std::size_t                                         scanned_ = 0;
+        std::map<std::filesystem::path, AuditDirectory>     directories_;
+    };
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_audit();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_AUDIT_HPP
@@ -0,0 +1,245 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_blake3.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace TabsToSpaces
+{
+
+    namespace
+    {
+
+        using Words = std::array<std::uint32_t, 8>;
+        using Block = std::array<std::uint32_t, 16>;
+
+        constexpr Words iv
+        {
+            0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+            0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+        };
+
+        constexpr std::size_t messagePermutation[16]
+        {
+            2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8
+        };
+
+        enum : std::uint32_t
+        {
+            chunkStart = 1 << 0,
+            chunkEnd   = 1 << 1,
+            parent     = 1 << 2,
+            root       = 1 << 3,
+        };
+
+        void g(
+                Block&          state,
+                std::size_t     a,
+                std::size_t     b,
+                std::size_t     c,
+                std::size_t     d,
+                std::uint32_t   mx,
+                std::uint32_t   my
+            ) noexcept
+        {
+            state[a] = state[a] + state[b] + mx;
+            state[d] = std::rotr(state[d] ^ state[a], 16);
+            state[c] = state[c] + state[d];
+            state[b] = std::rotr(state[b] ^ state[c], 12);
+            state[a] = state[a] + state[b] + my;
+            state[d] = std::rotr(state[d] ^ state[a], 8);
+            state[c] = state[c] + state[d];
+            state[b] = std::rotr(state[b] ^ state[c], 7);
+        }
+
+        [[nodiscard]] auto compress(
+                Words const&    cv,
+                Block const&    blockWords,
+                std::uint64_t   counter,
+                std::uint32_t   blockLength,
+                std::uint32_t   flags
+            ) noexcept -> Block
+        {
+            Block state
+            {
+                cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+                iv[0], iv[1], iv[2], iv[3],
+                static_cast<std::uint32_t>(counter),
+                static_cast<std::uint32_t>(counter >> 32),
+                blockLength,
+                flags
+            };
+
+            auto m = blockWords;
+            for (int round = 0; round < 7; ++round) {
+                g(state, 0, 4,  8, 12, m[0],  m[1]);
+                g(state, 1, 5,  9, 13, m[2],  m[3]);
+                g(state, 2, 6, 10, 14, m[4],  m[5]);
+                g(state, 3, 7, 11, 15, m[6],  m[7]);
+                g(state, 0, 5, 10, 15, m[8],  m[9]);
+                g(state, 1, 6, 11, 12, m[10], m[11]);
+                g(state, 2, 7,  8, 13, m[12], m[13]);
+                g(state, 3, 4,  9, 14, m[14], m[15]);
+
+                Block permuted;
+                for (std::size_t i = 0; i < 16; ++i) {
+                    permuted[i] = m[messagePermutation[i]];
+                }
+
+                m = permuted;
+            }
+
+            for (std::size_t i = 0; i < 8; ++i) {
+                state[i]     ^= state[i + 8];
+                state[i + 8] ^= cv[i];
+            }
+
+            return state;
+        }
+
+        [[nodiscard]] auto firstWords(Block const& state) noexcept
+            -> Words
+        {
+            Words words;
+            std::copy_n(state.begin(), words.size(), words.begin());
+            return words;
+        }
+
+        [[nodiscard]] auto loadWords(std::uint8_t const* bytes) noexcept
+            -> Block
+        {
+            Block words;
+            for (std::size_t i = 0; i < words.size(); ++i, bytes += 4) {
+                words[i] = std::uint32_t{bytes[0]}
+                        | (std::uint32_t{bytes[1]} << 8)
+                        | (std::uint32_t{bytes[2]} << 16)
+                        | (std::uint32_t{bytes[3]} << 24);
+            }
+
+            return words;
+        }
+
+        // Input of a compression that yields either a chaining value or the root output.
+        struct Output
+        {
+            Words           cv;
+            Block           blockWords;
+            std::uint64_t   counter;
+            std::uint32_t   blockLength;
+            std::uint32_t   flags;
+
+            [[nodiscard]] auto chainingValue() const noexcept
+                -> Words
+            {
+                return firstWords(compress(cv, blockWords, counter, blockLength, flags));
+            }
+        };
+
+        [[nodiscard]] auto parentOutput(
+                Words const& left,
+                Words const& right
+            ) noexcept -> Output
+        {
+            Block blockWords;
+            std::ranges::copy(left,  blockWords.begin());
+            std::ranges::copy(right, blockWords.begin() + left.size());
+            return { iv, blockWords, 0, 64, parent };
+        }
+
+    }
+
+
+    Blake3::Blake3() noexcept
+        : chunkCv_(iv)
+    {
+    }
+
+    void Blake3::addChunkCv(
+            Words           cv,
+            std::uint64_t   totalChunks
+        ) noexcept
+    {
+        // Merge complete subtrees: one per trailing zero bit of the chunk count.
+        for (; (totalChunks & 1) == 0; totalChunks >>= 1) {
+            cv = parentOutput(cvStack_[--cvStackLength_], cv).chainingValue();
+        }
+
+        cvStack_[cvStackLength_++] = cv;
+    }
+
+    void Blake3::update(std::string_view data) noexcept
+    {
+        auto input = reinterpret_cast<std::uint8_t const*>(data.data());
+        auto size  = data.size();
+
+        while (size != 0) {
+            if (chunkLength() == chunkSize) {
+                // The chunk is complete and more input follows, so it is not the root.
+                auto const startFlag = blocksCompressed_ == 0 ? chunkStart : 0u;
+                auto const chunkCv   = Output{ chunkCv_, loadWords(block_.data()), chunkCounter_,
+                        static_cast<std::uint32_t>(blockLength_), startFlag | chunkEnd }.chainingValue();
+
+                addChunkCv(chunkCv, ++chunkCounter_);
+                chunkCv_          = iv;
+                blockLength_      = 0;
+                blocksCompressed_ = 0;
+                block_.fill(0);
+            }
+
+            if (blockLength_ == blockSize) {
+                auto const startFlag = blocksCompressed_ == 0 ? chunkStart : 0u;
+                chunkCv_ = firstWords(compress(chunkCv_, loadWords(block_.data()), chunkCounter_,
+                        static_cast<std::uint32_t>(blockSize), startFlag));
+
+                ++blocksCompressed_;
+                blockLength_ = 0;
+                block_.fill(0);
+            }
+
+            auto const taken = std::min(size, blockSize - blockLength_);
+            std::copy_n(input, taken, block_.data() + blockLength_);
+            blockLength_ += taken;
+            input        += taken;
+            size         -= taken;
+        }
+    }
+
+    auto Blake3::digest() const noexcept
+        -> Digest
+    {
+        auto const startFlag = blocksCompressed_ == 0 ? chunkStart : 0u;
+        auto output = Output{ chunkCv_, loadWords(block_.data()), chunkCounter_,
+                static_cast<std::uint32_t>(blockLength_), startFlag | chunkEnd };
+
+        for (auto i = cvStackLength_; i != 0; --i) {
+            output = parentOutput(cvStack_[i - 1], output.chainingValue());
+        }
+
+        auto const words = compress(output.cv, output.blockWords, 0, output.blockLength, output.flags | root);
+
+        Digest digest;
+        for (std::size_t i = 0; i < digest.size(); ++i) {
+            digest[i] = static_cast<std::uint8_t>(words[i / 4] >> (8 * (i % 4)));
+        }
+
+        return digest;
+    }
+
+    auto Blake3::toHex(Digest const& digest)
+        -> std::string
+    {
+        constexpr char hex[] = "0123456789abcdef";
+
+        std::string result;
+        result.reserve(2 * digest.size());
+        for (auto byte : digest) {
+            result += hex[byte >> 4];
+            result += hex[byte & 0xF];
+        }
+
+        return result;
+    }
+
+}
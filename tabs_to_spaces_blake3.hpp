@@ -0,0 +1,63 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_BLAKE3_HPP
+#define TABS_TO_SPACES_BLAKE3_HPP
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace TabsToSpaces
+{
+
+    // Streaming BLAKE3 hash (portable implementation following the reference one).
+    class Blake3
+    {
+    public:
+        static constexpr std::size_t digestSize = 32;
+
+        using Digest = std::array<std::uint8_t, digestSize>;
+
+        Blake3() noexcept;
+
+        void update(std::string_view data) noexcept;
+
+        [[nodiscard]] auto digest() const noexcept
+            -> Digest;
+
+        [[nodiscard]] static auto toHex(Digest const& digest)
+            -> std::string;
+
+    private:
+        static constexpr std::size_t blockSize = 64;
+        static constexpr std::size_t chunkSize = 1024;
+        static constexpr std::size_t maxDepth  = 54;
+
+        using Words = std::array<std::uint32_t, 8>;
+
+        // The chunk being hashed.
+        Words                               chunkCv_;
+        std::uint64_t                       chunkCounter_    = 0;
+        std::array<std::uint8_t, blockSize> block_           {};
+        std::size_t                         blockLength_     = 0;
+        std::size_t                         blocksCompressed_ = 0;
+
+        // Chaining values of the complete subtrees.
+        std::array<Words, maxDepth>         cvStack_         {};
+        std::size_t                         cvStackLength_   = 0;
+
+        [[nodiscard]] auto chunkLength() const noexcept
+            -> std::size_t
+        {
+            return blockSize * blocksCompressed_ + blockLength_;
+        }
+
+        void addChunkCv(Words cv, std::uint64_t totalChunks) noexcept;
+    };
+
+}
+
+#endif//TABS_TO_SPACES_BLAKE3_HPP
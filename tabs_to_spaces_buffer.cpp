@@ -0,0 +1,311 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_buffer.hpp"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <cstdint>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif//__linux__
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+    namespace
+    {
+
+        constexpr std::size_t hugePageSize  = std::size_t{2} << 20;
+        constexpr std::size_t smallPageSize = std::size_t{4} << 10;
+
+        // Fault the pages in by writing to each.
+        void touchPages(
+                char*           data,
+                std::size_t     size
+            ) noexcept
+        {
+            for (std::size_t offset = 0; offset < size; offset += smallPageSize) {
+                data[offset] = 0;
+            }
+        }
+
+        // Memory of the size (a multiple of hugePageSize) aligned to a huge page.
+        [[nodiscard]] auto mapMemory(
+                std::size_t     size,
+                Prefault        prefault
+            ) -> char*
+        {
+        #ifdef __linux__
+            // Map a huge page more to align the start, then unmap the ends.
+            auto* const raw = static_cast<char*>(::mmap(nullptr, size + hugePageSize,
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (raw == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+
+            auto const misalignment = reinterpret_cast<std::uintptr_t>(raw) % hugePageSize;
+            auto* const data = raw + (misalignment == 0 ? 0 : hugePageSize - misalignment);
+            if (data != raw) {
+                ::munmap(raw, static_cast<std::size_t>(data - raw));
+            }
+
+            ::munmap(data + size, hugePageSize - static_cast<std::size_t>(data - raw));
+
+        #ifdef  MADV_HUGEPAGE
+            ::madvise(data, size, MADV_HUGEPAGE);   // fails harmlessly without transparent huge pages
+        #endif//MADV_HUGEPAGE
+
+            // Populated only after the advice: MAP_POPULATE at mmap would fault small pages in.
+            if (prefault == Prefault::Yes) {
+            #ifdef  MADV_POPULATE_WRITE
+                if (::madvise(data, size, MADV_POPULATE_WRITE) != 0)
+            #endif//MADV_POPULATE_WRITE
+                {
+                    touchPages(data, size);
+                }
+            }
+
+            return data;
+        #else
+            auto* const data = static_cast<char*>(::operator new(size));
+            if (prefault == Prefault::Yes) {
+                touchPages(data, size);
+            }
+
+            return data;
+        #endif//__linux__
+        }
+
+        void unmapMemory(
+                char*           data,
+                std::size_t     size
+            ) noexcept
+        {
+        #ifdef __linux__
+            ::munmap(data, size);
+        #else
+            static_cast<void>(size);
+            ::operator delete(data);
+        #endif//__linux__
+        }
+
+    }
+
+
+    TextBuffer::TextBuffer(TextBuffer&& other) noexcept
+        : pool_(other.pool_)
+        , string_(std::move(other.string_))
+        , mapping_(std::exchange(other.mapping_, nullptr))
+        , capacity_(std::exchange(other.capacity_, 0))
+        , size_(std::exchange(other.size_, 0))
+    {
+    }
+
+    auto TextBuffer::operator=(TextBuffer&& other) noexcept
+        -> TextBuffer&
+    {
+        if (this != &other) {
+            release();
+            pool_     = other.pool_;
+            string_   = std::move(other.string_);
+            mapping_  = std::exchange(other.mapping_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_     = std::exchange(other.size_, 0);
+        }
+
+        return *this;
+    }
+
+    void TextBuffer::resize(std::size_t size)
+    {
+        if (mapping_ == nullptr) {
+            if (pool_ == nullptr || size < pool_->minimumSize()) {
+                string_.resize(size);
+                return;
+            }
+        } else if (size <= capacity_) {
+            size_ = size;
+            return;
+        }
+
+        // Move the contents into a mapping large enough.
+        auto const mapping = pool_->acquire(size);
+        auto const kept    = view();
+        std::ranges::copy(kept, mapping.data);
+        release();
+
+        mapping_  = mapping.data;
+        capacity_ = mapping.size;
+        size_     = size;
+    }
+
+    void TextBuffer::release() noexcept
+    {
+        if (mapping_ != nullptr) {
+            pool_->release({ mapping_, capacity_ });
+            mapping_  = nullptr;
+            capacity_ = 0;
+            size_     = 0;
+        }
+
+        string_ = std::string{};
+    }
+
+
+    LargeBufferPool::LargeBufferPool(
+            Prefault        prefault,
+            std::size_t     minimumSize,
+            std::size_t     keep
+        ) noexcept
+        : prefault_(prefault)
+        , minimumSize_(minimumSize)
+        , keep_(keep)
+    {
+    }
+
+    LargeBufferPool::~LargeBufferPool()
+    {
+        for (auto const& mapping : free_) {
+            unmapMemory(mapping.data, mapping.size);
+        }
+    }
+
+    void LargeBufferPool::setPrefault(Prefault prefault) noexcept
+    {
+        std::lock_guard lock{mutex_};
+        prefault_ = prefault;
+    }
+
+    auto LargeBufferPool::acquire(std::size_t size)
+        -> Mapping
+    {
+        Prefault prefault;
+        {
+            std::lock_guard lock{mutex_};
+            auto best = free_.end();
+            for (auto mapping = free_.begin(); mapping != free_.end(); ++mapping) {
+                if (mapping->size >= size && (best == free_.end() || mapping->size < best->size)) {
+                    best = mapping;
+                }
+            }
+
+            if (best != free_.end()) {
+                auto const mapping = *best;
+                free_.erase(best);
+                return mapping;
+            }
+
+            prefault = prefault_;
+        }
+
+        auto const rounded = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+        return { mapMemory(rounded, prefault), rounded };
+    }
+
+    void LargeBufferPool::release(Mapping mapping) noexcept
+    {
+        std::lock_guard lock{mutex_};
+        if (free_.size() >= keep_) {
+            // Drop the smallest of the kept mappings and this one.
+            auto const smallest = std::ranges::min_element(free_, {}, &Mapping::size);
+            if (smallest == free_.end() || smallest->size >= mapping.size) {
+                unmapMemory(mapping.data, mapping.size);
+                return;
+            }
+
+            unmapMemory(smallest->data, smallest->size);
+            *smallest = mapping;
+            return;
+        }
+
+        try {
+            free_.push_back(mapping);
+        } catch (...) {
+            unmapMemory(mapping.data, mapping.size);
+        }
+    }
+
+
+    auto tabsToSpaces(
+            std::string_view    file,
+            Config              config,
+            LargeBufferPool*    pool
+        ) -> TextBuffer
+    {
+        TextBuffer output{pool};
+        Kernel::convertText(file, config, output);
+        return output;
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_buffer()
+    {
+        int errors = 0;
+        auto check = [&errors](bool ok, std::string_view what)
+            {
+                if (!ok) {
+                    std::clog << "Test failed: LargeBufferPool "sv << what << '\n';
+                    ++errors;
+                }
+            };
+
+        try {
+            LargeBufferPool pool(Prefault::No, 64 << 10, 1);
+
+            Config config;
+            config.finalNewline       = FinalNewline::Ensure;
+            config.trailingBlankLines = TrailingBlankLines::Delete;
+
+            auto const small = "\tx \n\n"sv;
+            auto const smallOutput = tabsToSpaces(small, config, &pool);
+            check(!smallOutput.mapped() && smallOutput.view() == tabsToSpaces(small, config), "small output");
+
+            std::string large;
+            while (large.size() < 100'000) {
+                large += "\tline\twith tabs\n"sv;
+            }
+
+            large += "\t\t\n\nlast"sv;
+            auto const expected = tabsToSpaces(std::string_view{large}, config);
+
+            char const* first = nullptr;
+            {
+                auto const output = tabsToSpaces(std::string_view{large}, config, &pool);
+                first = output.view().data();
+                check(output.mapped() && output.view() == expected, "large output");
+            }
+
+            // The mapping released by the first output is reused.
+            auto output = tabsToSpaces(std::string_view{large}, config, &pool);
+            check(output.view().data() == first && output.view() == expected, "reuse");
+
+            // Growing past the mapping keeps the contents.
+            output.resize(3 << 20);
+            check(output.view().starts_with(expected), "growth");
+
+            pool.setPrefault(Prefault::Yes);
+            TextBuffer buffer{&pool};
+            buffer.resize(5 << 20);
+            buffer.data()[(5 << 20) - 1] = 'x';
+            check(buffer.mapped() && buffer.view().ends_with('x'), "prefaulted");
+
+            auto moved = std::move(buffer);
+            check(moved.mapped() && !buffer.mapped() && moved.size() == 5 << 20, "move");
+        } catch (std::exception const& e) {
+            check(false, e.what());
+        }
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
@@ -0,0 +1,151 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_BUFFER_HPP
+#define TABS_TO_SPACES_BUFFER_HPP
+
+#include "tabs_to_spaces.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+namespace TabsToSpaces
+{
+
+    // Outputs from this size on are worth a mapping of their own.
+    inline constexpr std::size_t largeBufferSize = std::size_t{16} << 20;
+
+    enum class Prefault
+    {
+        No,         // the pages are faulted in as the output is written
+        Yes,        // the pages are faulted in when the mapping is made
+    };
+
+    class LargeBufferPool;
+
+    // Text written by the conversion: in an ordinary string, or from the minimum size of
+    // the pool on in a mapping of the pool, given back to it when released. The first resize
+    // (to the size estimate of the conversion) chooses. Bytes added by resize are not
+    // initialized in a mapping.
+    class TextBuffer
+    {
+    public:
+        // Always a string if pool is null.
+        explicit TextBuffer(LargeBufferPool* pool = nullptr) noexcept
+            : pool_(pool)
+        {
+        }
+
+        TextBuffer(TextBuffer&& other) noexcept;
+        auto operator=(TextBuffer&& other) noexcept -> TextBuffer&;
+
+        ~TextBuffer()
+        {
+            release();
+        }
+
+        [[nodiscard]] auto data() noexcept
+            -> char*
+        {
+            return mapping_ != nullptr ? mapping_ : string_.data();
+        }
+
+        [[nodiscard]] auto size() const noexcept
+            -> std::size_t
+        {
+            return mapping_ != nullptr ? size_ : string_.size();
+        }
+
+        [[nodiscard]] auto view() const noexcept
+            -> std::string_view
+        {
+            return mapping_ != nullptr ? std::string_view{ mapping_, size_ } : std::string_view{ string_ };
+        }
+
+        [[nodiscard]] bool mapped() const noexcept
+        {
+            return mapping_ != nullptr;
+        }
+
+        // The contents up to the size are kept.
+        void resize(std::size_t size);
+
+        // Free the memory: the mapping goes back to the pool for the next buffer.
+        void release() noexcept;
+
+    private:
+        LargeBufferPool*    pool_;
+        std::string         string_;
+        char*               mapping_  = nullptr;
+        std::size_t         capacity_ = 0;
+        std::size_t         size_     = 0;
+    };
+
+    // Anonymous mappings for large outputs. They are aligned to and advised to be backed by
+    // huge pages (Linux transparent huge pages), so a 2 MiB page fault replaces 512 small ones,
+    // and optionally pre-faulted. Released mappings are kept for the next buffers (at most keep
+    // of them), so converting many large files faults the pages in once. Thread safe.
+    // Elsewhere than on Linux the memory comes from operator new and is reused the same way.
+    class LargeBufferPool
+    {
+    public:
+        explicit LargeBufferPool(
+                Prefault        prefault    = Prefault::No,
+                std::size_t     minimumSize = largeBufferSize,
+                std::size_t     keep        = 2
+            ) noexcept;
+
+        LargeBufferPool(LargeBufferPool const&) = delete;
+        auto operator=(LargeBufferPool const&) -> LargeBufferPool& = delete;
+
+        ~LargeBufferPool();
+
+        // Applies to the mappings made afterwards.
+        void setPrefault(Prefault prefault) noexcept;
+
+        [[nodiscard]] auto minimumSize() const noexcept
+            -> std::size_t
+        {
+            return minimumSize_;
+        }
+
+    private:
+        friend class TextBuffer;
+
+        struct Mapping
+        {
+            char*           data = nullptr;
+            std::size_t     size = 0;
+        };
+
+        // A kept mapping of at least the size (the smallest such) or a new one.
+        [[nodiscard]] auto acquire(std::size_t size)
+            -> Mapping;
+
+        void release(Mapping mapping) noexcept;
+
+        std::mutex              mutex_;
+        std::vector<Mapping>    free_;
+        Prefault                prefault_;
+        std::size_t             minimumSize_;
+        std::size_t             keep_;
+    };
+
+    // Like tabsToSpaces(file, config), but an output from the minimum size of the pool on
+    // is written into a mapping of the pool instead of a new string.
+    [[nodiscard]] auto tabsToSpaces(
+            std::string_view    file,
+            Config              config,
+            LargeBufferPool*    pool
+        ) -> TextBuffer;
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_buffer();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_BUFFER_HPP
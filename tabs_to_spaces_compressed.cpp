@@ -0,0 +1,503 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_compressed.hpp"
+#include "tabs_to_spaces_blake3.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <array>
+#include <memory>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <sstream>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+#ifdef  TABS_TO_SPACES_GZIP
+#define ZLIB_CONST
+#include <zlib.h>
+#endif
+
+#ifdef  TABS_TO_SPACES_ZSTD
+#include <zstd.h>
+#endif
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+    auto detectCompression(std::string_view head) noexcept
+        -> Compression
+    {
+        if (head.starts_with("\x1F\x8B"sv)) {
+            return Compression::Gzip;
+        }
+
+        if (head.starts_with("\x28\xB5\x2F\xFD"sv)) {
+            return Compression::Zstd;
+        }
+
+        return Compression::None;
+    }
+
+    bool supportsCompression(Compression compression) noexcept
+    {
+        switch (compression) {
+        case Compression::None:
+            return true;
+
+        case Compression::Gzip:
+        #ifdef  TABS_TO_SPACES_GZIP
+            return true;
+        #else
+            return false;
+        #endif
+
+        case Compression::Zstd:
+        #ifdef  TABS_TO_SPACES_ZSTD
+            return true;
+        #else
+            return false;
+        #endif
+        }
+
+        return false;
+    }
+
+    auto toString(Compression compression) noexcept
+        -> std::string_view
+    {
+        switch (compression) {
+        case Compression::None: return "none"sv;
+        case Compression::Gzip: return "gzip"sv;
+        case Compression::Zstd: return "zstd"sv;
+        }
+
+        return "unknown"sv;
+    }
+
+    namespace
+    {
+
+        // Size of the blocks read, decompressed and compressed at once.
+        constexpr std::size_t streamBlockSize = 256 * 1024;
+
+    #ifdef  TABS_TO_SPACES_GZIP
+        // Single-member gzip output; concatenated members are accepted on input.
+        class GzipCodec
+        {
+        public:
+            GzipCodec()
+            {
+                if (inflateInit2(&inflate_, 15 + 16) != Z_OK) {
+                    throw std::runtime_error("gzip: decompressor initialization failed");
+                }
+
+                if (deflateInit2(&deflate_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    inflateEnd(&inflate_);
+                    throw std::runtime_error("gzip: compressor initialization failed");
+                }
+            }
+
+            GzipCodec(GzipCodec const&) = delete;
+            GzipCodec& operator=(GzipCodec const&) = delete;
+
+            ~GzipCodec()
+            {
+                inflateEnd(&inflate_);
+                deflateEnd(&deflate_);
+            }
+
+            template <typename Sink>
+            void decompress(
+                    std::string_view    in,
+                    Sink&&              sink
+                )
+            {
+                inflate_.next_in  = reinterpret_cast<Bytef const*>(in.data());
+                inflate_.avail_in = static_cast<uInt>(in.size());
+                for (;;) {
+                    if (memberEnded_) {
+                        if (inflate_.avail_in == 0) {
+                            return;
+                        }
+
+                        // A member starts with 0x1F: zeros after a member are padding (of tape or
+                        // block devices) ending the stream, as gzip -d reads them.
+                        if (padding_ || *inflate_.next_in == 0) {
+                            padding_ = true;
+                            if (!std::all_of(inflate_.next_in, inflate_.next_in + inflate_.avail_in,
+                                    [](Bytef byte) { return byte == 0; })) {
+                                throw std::runtime_error("gzip: corrupt data");
+                            }
+
+                            return;
+                        }
+
+                        inflateReset(&inflate_); // the next concatenated member
+                        memberEnded_ = false;
+                    }
+
+                    inflate_.next_out  = reinterpret_cast<Bytef*>(buffer_.data());
+                    inflate_.avail_out = static_cast<uInt>(buffer_.size());
+
+                    auto const status = inflate(&inflate_, Z_NO_FLUSH);
+                    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+                        throw std::runtime_error("gzip: corrupt data");
+                    }
+
+                    memberEnded_ = status == Z_STREAM_END;
+                    sink(std::string_view{ buffer_.data(), buffer_.size() - inflate_.avail_out });
+
+                    // A full buffer may leave output pending even if all the input is consumed.
+                    if (inflate_.avail_in == 0 && (memberEnded_ || inflate_.avail_out != 0)) {
+                        return;
+                    }
+                }
+            }
+
+            void finishDecompress() const
+            {
+                if (!memberEnded_) {
+                    throw std::runtime_error("gzip: unexpected end of data");
+                }
+            }
+
+            template <typename Sink>
+            void compress(
+                    std::string_view    in,
+                    bool                end,
+                    Sink&&              sink
+                )
+            {
+                deflate_.next_in  = reinterpret_cast<Bytef const*>(in.data());
+                deflate_.avail_in = static_cast<uInt>(in.size());
+                for (;;) {
+                    deflate_.next_out  = reinterpret_cast<Bytef*>(buffer_.data());
+                    deflate_.avail_out = static_cast<uInt>(buffer_.size());
+
+                    auto const status = deflate(&deflate_, end ? Z_FINISH : Z_NO_FLUSH);
+                    if (status == Z_STREAM_ERROR) {
+                        throw std::runtime_error("gzip: compression failed");
+                    }
+
+                    sink(std::string_view{ buffer_.data(), buffer_.size() - deflate_.avail_out });
+                    if (end ? status == Z_STREAM_END : deflate_.avail_out != 0) {
+                        return;
+                    }
+                }
+            }
+
+        private:
+            z_stream                            inflate_     {};
+            z_stream                            deflate_     {};
+            bool                                memberEnded_ = false;
+            bool                                padding_     = false;
+            std::array<char, streamBlockSize>   buffer_;
+        };
+    #endif//TABS_TO_SPACES_GZIP
+
+    #ifdef  TABS_TO_SPACES_ZSTD
+        // Single-frame zstd output; concatenated frames are accepted on input.
+        class ZstdCodec
+        {
+        public:
+            ZstdCodec()
+                : decompressor_(ZSTD_createDCtx())
+                , compressor_(ZSTD_createCCtx())
+            {
+                if (decompressor_ == nullptr || compressor_ == nullptr) {
+                    throw std::runtime_error("zstd: initialization failed");
+                }
+            }
+
+            template <typename Sink>
+            void decompress(
+                    std::string_view    in,
+                    Sink&&              sink
+                )
+            {
+                ZSTD_inBuffer input{ in.data(), in.size(), 0 };
+                while (input.pos != input.size || !frameEnded_) {
+                    ZSTD_outBuffer output{ buffer_.data(), buffer_.size(), 0 };
+                    auto const status = ZSTD_decompressStream(decompressor_.get(), &output, &input);
+                    if (ZSTD_isError(status)) {
+                        throw std::runtime_error("zstd: "s + ZSTD_getErrorName(status));
+                    }
+
+                    frameEnded_ = status == 0;
+                    sink(std::string_view{ buffer_.data(), output.pos });
+
+                    // A full buffer may leave output pending even if all the input is consumed.
+                    if (input.pos == input.size && output.pos != output.size) {
+                        return;
+                    }
+                }
+            }
+
+            void finishDecompress() const
+            {
+                if (!frameEnded_) {
+                    throw std::runtime_error("zstd: unexpected end of data");
+                }
+            }
+
+            template <typename Sink>
+            void compress(
+                    std::string_view    in,
+                    bool                end,
+                    Sink&&              sink
+                )
+            {
+                ZSTD_inBuffer input{ in.data(), in.size(), 0 };
+                for (;;) {
+                    ZSTD_outBuffer output{ buffer_.data(), buffer_.size(), 0 };
+                    auto const remaining = ZSTD_compressStream2(
+                            compressor_.get(), &output, &input, end ? ZSTD_e_end : ZSTD_e_continue);
+
+                    if (ZSTD_isError(remaining)) {
+                        throw std::runtime_error("zstd: "s + ZSTD_getErrorName(remaining));
+                    }
+
+                    sink(std::string_view{ buffer_.data(), output.pos });
+                    if (end ? remaining == 0 : input.pos == input.size) {
+                        return;
+                    }
+                }
+            }
+
+        private:
+            struct FreeDecompressor { void operator()(ZSTD_DCtx* context) const noexcept { ZSTD_freeDCtx(context); } };
+            struct FreeCompressor   { void operator()(ZSTD_CCtx* context) const noexcept { ZSTD_freeCCtx(context); } };
+
+            std::unique_ptr<ZSTD_DCtx, FreeDecompressor>    decompressor_;
+            std::unique_ptr<ZSTD_CCtx, FreeCompressor>      compressor_;
+            bool                                            frameEnded_ = false;
+            std::array<char, streamBlockSize>               buffer_;
+        };
+    #endif//TABS_TO_SPACES_ZSTD
+
+        template <typename Codec>
+        auto convertStream(
+                std::istream&   input,
+                std::ostream&   output,
+                Config const&   config,
+                Blake3*         inputHash,
+                Blake3*         outputHash
+            ) -> CompressedStreamResult
+        {
+            CompressedStreamResult result;
+
+            auto codec = std::make_unique<Codec>(); // holds the large buffers
+            Converter       converter(config);
+            ChangeDetector  changes;
+            std::string     converted;
+
+            AsyncReader reader(input, inputHash, streamBlockSize);
+            AsyncWriter writer(output, outputHash, streamBlockSize);
+
+            auto const write = [&](std::string_view compressed)
+                {
+                    writer.write(compressed);
+                    result.outputSize += compressed.size();
+                };
+
+            auto const flush = [&](bool end)
+                {
+                    changes.output(converted);
+                    codec->compress(converted, end, write);
+                    converted.clear();
+                };
+
+            auto const convert = [&](std::string_view plain)
+                {
+                    changes.input(plain);
+                    converter.convert(plain, converted);
+                    flush(false);
+                };
+
+            for (auto read = reader.next(); !read.empty(); read = reader.next()) {
+                result.inputSize += read.size();
+                codec->decompress(read, convert);
+            }
+
+            codec->finishDecompress();
+            converter.finish(converted);
+            flush(true);
+            writer.finish();
+
+            result.changed = changes.changed();
+            return result;
+        }
+
+    }
+
+
+    auto convertCompressed(
+            std::istream&   input,
+            std::ostream&   output,
+            Compression     compression,
+            Config const&   config,
+            Blake3*         inputHash,
+            Blake3*         outputHash
+        ) -> CompressedStreamResult
+    {
+        switch (compression) {
+    #ifdef  TABS_TO_SPACES_GZIP
+        case Compression::Gzip:
+            return convertStream<GzipCodec>(input, output, config, inputHash, outputHash);
+    #endif
+
+    #ifdef  TABS_TO_SPACES_ZSTD
+        case Compression::Zstd:
+            return convertStream<ZstdCodec>(input, output, config, inputHash, outputHash);
+    #endif
+
+        default:
+            static_cast<void>(input);
+            static_cast<void>(output);
+            static_cast<void>(config);
+            static_cast<void>(inputHash);
+            static_cast<void>(outputHash);
+            throw std::invalid_argument("Compression format is not supported: "s + std::string{toString(compression)});
+        }
+    }
+
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    namespace
+    {
+
+        template <typename Codec>
+        [[nodiscard]] int test_codec(Compression compression)
+        {
+            auto const compress = [](std::string_view text)
+                {
+                    std::string compressed;
+                    Codec codec;
+                    codec.compress(text, true, [&](std::string_view part) { compressed += part; });
+                    return compressed;
+                };
+
+            auto const decompress = [](std::string_view compressed)
+                {
+                    std::string text;
+                    Codec codec;
+                    codec.decompress(compressed, [&](std::string_view part) { text += part; });
+                    codec.finishDecompress();
+                    return text;
+                };
+
+            struct TestCase
+            {
+                std::string file;
+                std::string expected;
+                bool        changed;
+            };
+
+            std::string large;
+            for (int i = 0; i < 100'000; ++i) {
+                large += "\tline "s + std::to_string(i) + '\n';
+            }
+
+            std::string largeExpected = large;
+            for (std::size_t pos = 0; (pos = largeExpected.find('\t', pos)) != largeExpected.npos;) {
+                largeExpected.replace(pos, 1, "    "sv);
+            }
+
+            TestCase const testCases[]
+            {
+                { ""s,              ""s,                false },
+                { "\tx\n"s,         "    x\n"s,         true  },
+                { "no tabs\n"s,     "no tabs\n"s,       false },
+                { large,            largeExpected,      true  },
+                { largeExpected,    largeExpected,      false },
+            };
+
+            int errors = 0;
+            for (auto& testCase : testCases) {
+                // Two concatenated members (frames) must be read as one stream.
+                auto const half = testCase.file.size() / 2;
+                std::istringstream input(
+                        compress(std::string_view{testCase.file}.substr(0, half))
+                      + compress(std::string_view{testCase.file}.substr(half)));
+
+                std::ostringstream output;
+                auto const result = convertCompressed(input, output, compression, {});
+                if (result.changed != testCase.changed || decompress(output.str()) != testCase.expected
+                 || detectCompression(output.str()) != compression) {
+                    std::clog << "Test failed: convertCompressed("sv << toString(compression)
+                              << ", "sv << testCase.file.size() << " bytes)\n"sv;
+
+                    ++errors;
+                }
+            }
+
+            // Truncated input is an error.
+            std::istringstream truncated(compress("text"sv).substr(0, 8));
+            std::ostringstream output;
+            try {
+                [[maybe_unused]] auto const result = convertCompressed(truncated, output, compression, {});
+                std::clog << "Test failed: convertCompressed("sv << toString(compression)
+                          << ") accepted truncated data\n"sv;
+
+                ++errors;
+            } catch (std::runtime_error const&) {
+            }
+
+            return errors;
+        }
+
+    }
+
+    int test_compressed()
+    {
+        int errors = 0;
+        if (detectCompression("\x1F\x8B\x08"sv) != Compression::Gzip
+         || detectCompression("\x28\xB5\x2F\xFD"sv) != Compression::Zstd
+         || detectCompression("\x1F"sv) != Compression::None) {
+            std::clog << "Test failed: detectCompression\n"sv;
+            ++errors;
+        }
+
+    #ifdef  TABS_TO_SPACES_GZIP
+        errors += test_codec<GzipCodec>(Compression::Gzip);
+
+        // Zero padding after the last member ends the stream, other data after it is an error.
+        std::string member;
+        GzipCodec{}.compress("\tx\n"sv, true, [&](std::string_view part) { member += part; });
+        std::istringstream padded(member + std::string(streamBlockSize + 100, '\0'));
+        std::ostringstream paddedOutput;
+        bool paddedRead = false;
+        try {
+            paddedRead = convertCompressed(padded, paddedOutput, Compression::Gzip, {}).changed;
+        } catch (std::runtime_error const&) {
+        }
+
+        if (!paddedRead) {
+            std::clog << "Test failed: convertCompressed(gzip) with zero padding\n"sv;
+            ++errors;
+        }
+
+        std::istringstream garbage(member + "\0\0x"s);
+        std::ostringstream garbageOutput;
+        try {
+            [[maybe_unused]] auto const result = convertCompressed(garbage, garbageOutput, Compression::Gzip, {});
+            std::clog << "Test failed: convertCompressed(gzip) accepted data after zero padding\n"sv;
+            ++errors;
+        } catch (std::runtime_error const&) {
+        }
+    #endif
+
+    #ifdef  TABS_TO_SPACES_ZSTD
+        errors += test_codec<ZstdCodec>(Compression::Zstd);
+    #endif
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
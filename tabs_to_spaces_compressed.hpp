@@ -0,0 +1,64 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_COMPRESSED_HPP
+#define TABS_TO_SPACES_COMPRESSED_HPP
+
+#include "tabs_to_spaces.hpp"
+#include "tabs_to_spaces_pipeline.hpp"
+
+#include <string_view>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+
+// Codecs are built in only if the build defines their macros and links their libraries:
+// TABS_TO_SPACES_GZIP with zlib, TABS_TO_SPACES_ZSTD with libzstd (see README.md).
+
+namespace TabsToSpaces
+{
+
+    class Blake3;
+
+    enum class Compression
+    {
+        None,
+        Gzip,
+        Zstd,
+    };
+
+    // Number of leading bytes detectCompression needs.
+    inline constexpr std::size_t compressionMagicSize = 4;
+
+    // Detect the compression format by the magic bytes at the file start.
+    [[nodiscard]] auto detectCompression(std::string_view head) noexcept
+        -> Compression;
+
+    [[nodiscard]] bool supportsCompression(Compression compression) noexcept;
+
+    [[nodiscard]] auto toString(Compression compression) noexcept
+        -> std::string_view;
+
+    // changed tells whether the decompressed content changed, the sizes are of compressed bytes.
+    using CompressedStreamResult = StreamResult;
+
+    // Decompress input, convert it and compress it in the same format to output in bounded blocks,
+    // so neither the whole content nor intermediate data is kept. Reading and writing the files
+    // overlap the processing. Compressed bytes read and written
+    // are hashed into inputHash and outputHash unless they are null.
+    auto convertCompressed(
+            std::istream&   input,
+            std::ostream&   output,
+            Compression     compression,
+            Config const&   config,
+            Blake3*         inputHash   = nullptr,
+            Blake3*         outputHash  = nullptr
+        ) -> CompressedStreamResult;
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_compressed();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_COMPRESSED_HPP
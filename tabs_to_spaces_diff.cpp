@@ -0,0 +1,232 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_diff.hpp"
+#include "tabs_to_spaces.hpp"
+#include "tabs_to_spaces_report.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+    namespace
+    {
+
+        // Lines with their new-line characters; the last one may have none.
+        [[nodiscard]] auto splitLines(std::string_view text)
+            -> std::vector<std::string_view>
+        {
+            std::vector<std::string_view> lines;
+            while (!text.empty()) {
+                auto const end = std::min(text.find('\n'), text.size() - 1) + 1;
+                lines.push_back(text.substr(0, end));
+                text.remove_prefix(end);
+            }
+
+            return lines;
+        }
+
+        void writeLine(
+                std::ostream&       os,
+                char                prefix,
+                std::string_view    line
+            )
+        {
+            os << prefix << line;
+            if (!line.ends_with('\n')) {
+                os << "\n\\ No newline at end of file\n"sv;
+            }
+        }
+
+        // Line range of a hunk in diff notation: the first line and the count,
+        // the line before an empty range, the count omitted if it is 1.
+        void writeRange(
+                std::ostream&   os,
+                std::size_t     start,
+                std::size_t     count
+            )
+        {
+            os << (count == 0 ? start : start + 1);
+            if (count != 1) {
+                os << ',' << count;
+            }
+        }
+
+    }
+
+    bool writeUnifiedDiff(
+            std::ostream&                   os,
+            std::filesystem::path const&    path,
+            std::string_view                input,
+            std::string_view                output,
+            std::size_t                     context
+        )
+    {
+        if (input == output) {
+            return false;
+        }
+
+        auto const oldLines = splitLines(input);
+        auto const newLines = splitLines(output);
+        auto const lines    = std::max(oldLines.size(), newLines.size());
+
+        auto const changed = [&](std::size_t line)
+            {
+                return line >= oldLines.size() || line >= newLines.size() || oldLines[line] != newLines[line];
+            };
+
+        auto const nextChange = [&](std::size_t line)
+            {
+                while (line < lines && !changed(line)) {
+                    ++line;
+                }
+
+                return line;
+            };
+
+        auto const name = toUtf8(path);
+        os << "--- "sv << name << "\n+++ "sv << name << '\n';
+
+        for (auto change = nextChange(0); change < lines; ) {
+            // Changes closer than twice the context share a hunk.
+            auto const start = change - std::min(change, context);
+            auto end = change;
+            while (change < lines) {
+                while (end < lines && changed(end)) {
+                    ++end;
+                }
+
+                change = nextChange(end);
+                if (change >= lines || change - end > 2 * context) {
+                    break;
+                }
+
+                end = change;
+            }
+
+            end = std::min(lines, end + context);
+
+            auto const oldStart = std::min(start, oldLines.size());
+            auto const newStart = std::min(start, newLines.size());
+            os << "@@ -"sv;
+            writeRange(os, oldStart, std::min(end, oldLines.size()) - oldStart);
+            os << " +"sv;
+            writeRange(os, newStart, std::min(end, newLines.size()) - newStart);
+            os << " @@\n"sv;
+
+            for (auto line = start; line < end; ) {
+                if (!changed(line)) {
+                    writeLine(os, ' ', oldLines[line++]);
+                    continue;
+                }
+
+                auto runEnd = line;
+                while (runEnd < end && changed(runEnd)) {
+                    ++runEnd;
+                }
+
+                for (auto i = line; i < std::min(runEnd, oldLines.size()); ++i) {
+                    writeLine(os, '-', oldLines[i]);
+                }
+
+                for (auto i = line; i < std::min(runEnd, newLines.size()); ++i) {
+                    writeLine(os, '+', newLines[i]);
+                }
+
+                line = runEnd;
+            }
+        }
+
+        return true;
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_diff()
+    {
+        int errors = 0;
+
+        Config trimEof;
+        trimEof.trailingBlankLines = TrailingBlankLines::Delete;
+        trimEof.finalNewline       = FinalNewline::Ensure;
+
+        struct
+        {
+            std::string_view    input;
+            Config              config;
+            std::string_view    diff;
+        } const tests[]
+        {
+            { "a\nb\n"sv, {}, ""sv },
+            { "\ta\nb\n"sv, {},
+                "--- f.c\n+++ f.c\n"
+                "@@ -1,2 +1,2 @@\n"
+                "-\ta\n"
+                "+    a\n"
+                " b\n"sv },
+            { "1\n2\n3\n4\n\t5\n6\n7\n8\n9\n10\n11\n12\n\t13\n14\n"sv, {},
+                "--- f.c\n+++ f.c\n"
+                "@@ -2,7 +2,7 @@\n"
+                " 2\n 3\n 4\n"
+                "-\t5\n"
+                "+    5\n"
+                " 6\n 7\n 8\n"
+                "@@ -10,5 +10,5 @@\n"
+                " 10\n 11\n 12\n"
+                "-\t13\n"
+                "+    13\n"
+                " 14\n"sv },
+            { "\t1\n2\n3\n4\n5\n6\n7\n\t8\n"sv, {},
+                "--- f.c\n+++ f.c\n"
+                "@@ -1,8 +1,8 @@\n"
+                "-\t1\n"
+                "+    1\n"
+                " 2\n 3\n 4\n 5\n 6\n 7\n"
+                "-\t8\n"
+                "+    8\n"sv },
+            { "a\nb\n\n\nc"sv, trimEof,
+                "--- f.c\n+++ f.c\n"
+                "@@ -2,4 +2,4 @@\n"
+                " b\n \n \n"
+                "-c\n"
+                "\\ No newline at end of file\n"
+                "+c\n"sv },
+            { "a\nb\n\n \n"sv, trimEof,
+                "--- f.c\n+++ f.c\n"
+                "@@ -1,4 +1,2 @@\n"
+                " a\n b\n"
+                "-\n"
+                "- \n"sv },
+            { "\t"sv, {},
+                "--- f.c\n+++ f.c\n"
+                "@@ -1 +1 @@\n"
+                "-\t\n"
+                "\\ No newline at end of file\n"
+                "+    \n"
+                "\\ No newline at end of file\n"sv },
+        };
+
+        for (auto const& test : tests) {
+            std::ostringstream diff;
+            bool const differs = writeUnifiedDiff(diff, "f.c", test.input, tabsToSpaces(test.input, test.config));
+            if (diff.str() != test.diff || differs != !test.diff.empty()) {
+                std::clog << "Test failed: writeUnifiedDiff("sv << std::quoted(test.input)
+                    << ") gives:\n"sv << diff.str();
+                ++errors;
+            }
+        }
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
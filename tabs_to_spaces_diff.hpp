@@ -0,0 +1,35 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_DIFF_HPP
+#define TABS_TO_SPACES_DIFF_HPP
+
+#include <string_view>
+#include <filesystem>
+#include <ostream>
+
+namespace TabsToSpaces
+{
+
+    // Lines of context around the changes in unified diffs.
+    inline constexpr std::size_t diffContext = 3;
+
+    // Write a unified diff from input to its conversion output, nothing if they are equal.
+    // The conversion keeps the lines in place (it alters them or drops blank lines at the end),
+    // so lines are paired by their numbers in one pass instead of searching for common subsequences.
+    // Returns whether the texts differ.
+    bool writeUnifiedDiff(
+            std::ostream&                   os,
+            std::filesystem::path const&    path,
+            std::string_view                input,
+            std::string_view                output,
+            std::size_t                     context = diffContext
+        );
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_diff();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_DIFF_HPP
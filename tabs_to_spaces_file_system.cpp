@@ -0,0 +1,766 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_file_system.hpp"
+#include "tabs_to_spaces.hpp"
+
+#include <stdexcept>
+#include <string_view>
+#include <fstream>
+#include <spanstream>
+#include <system_error>
+#include <chrono>
+#include <cerrno>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <algorithm>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <linux/fs.h>
+#endif//__linux__
+
+#ifdef _WIN32
+#define WC(x) L##x
+#else
+#define WC(x) x
+#endif
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+    namespace fs = std::filesystem;
+
+    namespace
+    {
+
+        [[nodiscard]] auto tempPath(fs::path const& target)
+            -> fs::path
+        {
+            fs::path temp = target;
+            temp += WC(".tabs2spaces.tmp"sv);
+            return temp;
+        }
+
+        [[nodiscard]] auto lockPath(fs::path const& target)
+            -> fs::path
+        {
+            fs::path lock = target;
+            lock += WC(".lock"sv);
+            return lock;
+        }
+
+        [[nodiscard]] auto lockHeld(fs::path const& lock)
+            -> fs::filesystem_error
+        {
+            return { "cannot create lock file", lock, std::make_error_code(std::errc::file_exists) };
+        }
+
+    #ifdef __linux__
+        [[nodiscard]] bool copyFileRange(
+                int in,
+                int out
+            ) noexcept
+        {
+            for (;;) {
+                auto const copied = ::copy_file_range(in, nullptr, out, nullptr, std::size_t{1} << 30, 0);
+                if (copied <= 0) {
+                    return copied == 0;
+                }
+            }
+        }
+    #endif//__linux__
+
+    }
+
+
+    auto NativeFileSystem::status(fs::path const& path)
+        -> FileStatus
+    {
+        // One call for the type, the size and the modification time in nanoseconds.
+    #ifdef __linux__
+        struct ::stat info;
+        if (::stat(path.c_str(), &info) != 0) {
+            return {};
+        }
+
+        auto const modified = std::int64_t{info.st_mtim.tv_sec} * 1'000'000'000 + info.st_mtim.tv_nsec;
+        if (S_ISREG(info.st_mode)) {
+            return { FileType::Regular, static_cast<std::uintmax_t>(info.st_size), modified };
+        }
+
+        return { S_ISDIR(info.st_mode) ? FileType::Directory : FileType::Other, 0, modified };
+    #else
+        std::error_code ec;
+        auto const status = fs::status(path, ec);
+        if (!fs::exists(status)) {
+            return {};
+        }
+
+        auto const modified = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                fs::last_write_time(path).time_since_epoch()).count();
+        if (fs::is_regular_file(status)) {
+            return { FileType::Regular, fs::file_size(path), modified };
+        }
+
+        return { fs::is_directory(status) ? FileType::Directory : FileType::Other, 0, modified };
+    #endif//__linux__
+    }
+
+    auto NativeFileSystem::list(fs::path const& directory)
+        -> std::vector<DirectoryEntry>
+    {
+        std::vector<DirectoryEntry> entries;
+        for (auto const& entry : fs::directory_iterator(directory)) {
+            auto type = FileType::Other;
+            if (entry.is_regular_file()) {
+                type = FileType::Regular;
+            } else if (entry.is_directory() && !entry.is_symlink()) {
+                type = FileType::Directory;
+            }
+
+            entries.push_back({ entry.path(), type });
+        }
+
+        return entries;
+    }
+
+    auto NativeFileSystem::read(fs::path const& path)
+        -> std::string
+    {
+        auto const fileSizeUmax = fs::file_size(path);
+        if (fileSizeUmax > SIZE_MAX) {
+            throw std::length_error("File is too big: "s + path.string());
+        }
+
+        auto const fileSize = static_cast<std::size_t>(fileSizeUmax);
+        std::string bytes(fileSize, '\0');
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("File read failed: "s + path.string());
+        }
+
+        file.read(bytes.data(), fileSize);
+        return bytes;
+    }
+
+    auto NativeFileSystem::openRead(fs::path const& path)
+        -> std::unique_ptr<std::istream>
+    {
+        auto file = std::make_unique<std::ifstream>(path, std::ios::binary);
+        if (!file->is_open()) {
+            throw std::runtime_error("File read failed: "s + path.string());
+        }
+
+        return file;
+    }
+
+    auto NativeFileSystem::writeTemp(fs::path const& target)
+        -> TempFile
+    {
+        auto temp = tempPath(target);
+        auto file = std::make_unique<std::ofstream>(temp, std::ios::binary);
+        if (!file->is_open()) {
+            throw std::runtime_error("File write failed: "s + temp.string());
+        }
+
+        return { std::move(temp), std::move(file) };
+    }
+
+    auto NativeFileSystem::writeLock(fs::path const& target)
+        -> TempFile
+    {
+        auto lock = lockPath(target);
+        auto file = std::make_unique<std::ofstream>(lock, std::ios::binary | std::ios::noreplace);
+        if (!file->is_open()) {
+            if (status(lock).type != FileType::NotFound) {
+                throw lockHeld(lock);
+            }
+
+            throw std::runtime_error("File write failed: "s + lock.string());
+        }
+
+        return { std::move(lock), std::move(file) };
+    }
+
+    auto NativeFileSystem::openAppend(fs::path const& path)
+        -> std::unique_ptr<std::ostream>
+    {
+        auto file = std::make_unique<std::ofstream>(path, std::ios::binary | std::ios::app);
+        if (!file->is_open()) {
+            throw std::runtime_error("File write failed: "s + path.string());
+        }
+
+        return file;
+    }
+
+    void NativeFileSystem::replace(
+            fs::path const& temp,
+            fs::path const& target
+        )
+    {
+        fs::rename(temp, target);
+    }
+
+    void NativeFileSystem::remove(fs::path const& path) noexcept
+    {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+
+    void NativeFileSystem::copy(
+            fs::path const& from,
+            fs::path const& to
+        )
+    {
+        // The copy replaces to like a conversion, so the other links of to (a snapshot) keep their data.
+        auto const temp = tempPath(to);
+        try {
+            // Share the data (reflink) or copy in the kernel where the file system supports it.
+        #ifdef __linux__
+            if (int const in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC); in != -1) {
+                bool cloned = false;
+                struct ::stat info;
+                if (int const out = ::fstat(in, &info) == 0
+                        ? ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666) : -1; out != -1) {
+                    // The permissions are copied too, as fs::copy_file does.
+                    cloned = ::fchmod(out, info.st_mode & 07777) == 0
+                          && (::ioctl(out, FICLONE, in) == 0 || copyFileRange(in, out));
+                    cloned = ::close(out) == 0 && cloned;
+                }
+
+                ::close(in);
+                if (cloned) {
+                    fs::rename(temp, to);
+                    return;
+                }
+            }
+        #endif//__linux__
+
+            fs::copy_file(from, temp, fs::copy_options::overwrite_existing);
+            fs::rename(temp, to);
+        } catch (...) {
+            remove(temp);
+            throw;
+        }
+    }
+
+    void NativeFileSystem::link(
+            fs::path const& from,
+            fs::path const& to
+        )
+    {
+        fs::create_hard_link(from, to);
+    }
+
+    void NativeFileSystem::createDirectories(fs::path const& path)
+    {
+        fs::create_directories(path);
+    }
+
+    bool NativeFileSystem::equivalent(
+            fs::path const& a,
+            fs::path const& b
+        ) noexcept
+    {
+        std::error_code ec;
+        return fs::equivalent(a, b, ec);
+    }
+
+    auto NativeFileSystem::readAttribute(
+            fs::path const&     path,
+            std::string const&  name
+        ) -> std::optional<std::string>
+    {
+    #ifdef __linux__
+        // Attributes are small: read into a buffer of a likely size, retry with the actual size.
+        std::string value(64, '\0');
+        for (;;) {
+            auto const size = ::getxattr(path.c_str(), name.c_str(), value.data(), value.size());
+            if (size >= 0) {
+                value.resize(static_cast<std::size_t>(size));
+                return value;
+            }
+
+            if (errno != ERANGE) {
+                return std::nullopt;
+            }
+
+            auto const needed = ::getxattr(path.c_str(), name.c_str(), nullptr, 0);
+            if (needed < 0) {
+                return std::nullopt;
+            }
+
+            value.resize(static_cast<std::size_t>(needed) + 1);
+        }
+    #else
+        static_cast<void>(path);
+        static_cast<void>(name);
+        return std::nullopt;
+    #endif//__linux__
+    }
+
+    bool NativeFileSystem::writeAttribute(
+            fs::path const&     path,
+            std::string const&  name,
+            std::string_view    value
+        ) noexcept
+    {
+    #ifdef __linux__
+        return ::setxattr(path.c_str(), name.c_str(), value.data(), value.size(), 0) == 0;
+    #else
+        static_cast<void>(path);
+        static_cast<void>(name);
+        static_cast<void>(value);
+        return false;
+    #endif//__linux__
+    }
+
+    auto nativeFileSystem() noexcept
+        -> NativeFileSystem&
+    {
+        static NativeFileSystem fileSystem;
+        return fileSystem;
+    }
+
+
+    namespace
+    {
+
+        // Appends everything written to the string.
+        class StringAppendBuffer
+            : public std::streambuf
+        {
+        public:
+            explicit StringAppendBuffer(std::string& output) noexcept
+                : output_(output)
+            {
+            }
+
+        protected:
+            auto overflow(int_type ch)
+                -> int_type override
+            {
+                if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                    output_ += traits_type::to_char_type(ch);
+                }
+
+                return traits_type::not_eof(ch);
+            }
+
+            auto xsputn(
+                    char const*     data,
+                    std::streamsize size
+                ) -> std::streamsize override
+            {
+                output_.append(data, static_cast<std::size_t>(size));
+                return size;
+            }
+
+        private:
+            std::string& output_;
+        };
+
+        class StringAppendStream
+            : public std::ostream
+        {
+        public:
+            explicit StringAppendStream(std::string& output)
+                : std::ostream(nullptr)
+                , buffer_(output)
+            {
+                rdbuf(&buffer_);
+            }
+
+        private:
+            StringAppendBuffer buffer_;
+        };
+
+        [[nodiscard]] auto notFound(
+                char const*     what,
+                fs::path const& path
+            ) -> fs::filesystem_error
+        {
+            return { what, path, std::make_error_code(std::errc::no_such_file_or_directory) };
+        }
+
+    }
+
+
+    auto MemoryFileSystem::key(fs::path const& path)
+        -> fs::path
+    {
+        auto normal = path.lexically_normal();
+        if (!normal.has_filename() && normal.has_relative_path()) {
+            normal = normal.parent_path();  // "dir/"
+        }
+
+        return normal.empty() ? fs::path{WC("."sv)} : normal;
+    }
+
+    void MemoryFileSystem::addToParents(fs::path const& key)
+    {
+        for (auto child = key; ; ) {
+            auto parent = child.parent_path();
+            if (parent == child || child == WC("."sv)) {
+                break;  // the root
+            }
+
+            if (parent.empty()) {
+                parent = WC("."sv);
+            }
+
+            if (!directories_[parent].insert(child.filename()).second) {
+                break;  // the parents are already there
+            }
+
+            child = std::move(parent);
+        }
+    }
+
+    void MemoryFileSystem::addFile(
+            fs::path const& path,
+            std::string     content
+        )
+    {
+        auto const fileKey = key(path);
+        if (directories_.contains(fileKey)) {
+            throw fs::filesystem_error("cannot write a file over a directory", path,
+                    std::make_error_code(std::errc::is_a_directory));
+        }
+
+        files_[fileKey] = { std::move(content), ++clock_, {} };
+        addToParents(fileKey);
+    }
+
+    auto MemoryFileSystem::file(fs::path const& path) const
+        -> std::string const*
+    {
+        auto const found = files_.find(key(path));
+        return found != files_.end() ? &found->second.content : nullptr;
+    }
+
+    auto MemoryFileSystem::content(fs::path const& path) const
+        -> std::string const&
+    {
+        if (auto const found = file(path)) {
+            return *found;
+        }
+
+        throw notFound("cannot open file", path);
+    }
+
+    auto MemoryFileSystem::status(fs::path const& path)
+        -> FileStatus
+    {
+        auto const pathKey = key(path);
+        if (auto const found = files_.find(pathKey); found != files_.end()) {
+            return { FileType::Regular, found->second.content.size(), found->second.modified };
+        }
+
+        return { directories_.contains(pathKey) ? FileType::Directory : FileType::NotFound };
+    }
+
+    auto MemoryFileSystem::list(fs::path const& directory)
+        -> std::vector<DirectoryEntry>
+    {
+        auto const found = directories_.find(key(directory));
+        if (found == directories_.end()) {
+            throw notFound("directory iterator cannot open directory", directory);
+        }
+
+        std::vector<DirectoryEntry> entries;
+        entries.reserve(found->second.size());
+        for (auto const& name : found->second) {
+            auto const entryKey = key(found->first / name);     // "./name" is "name"
+            entries.push_back({ directory / name,
+                files_.contains(entryKey) ? FileType::Regular : FileType::Directory });
+        }
+
+        return entries;
+    }
+
+    auto MemoryFileSystem::read(fs::path const& path)
+        -> std::string
+    {
+        return content(path);
+    }
+
+    auto MemoryFileSystem::openRead(fs::path const& path)
+        -> std::unique_ptr<std::istream>
+    {
+        return std::make_unique<std::ispanstream>(std::span<char const>{ content(path) });
+    }
+
+    auto MemoryFileSystem::writeTemp(fs::path const& target)
+        -> TempFile
+    {
+        auto temp = key(tempPath(target));
+        if (!directories_.contains(key(temp.parent_path()))) {
+            throw notFound("cannot create file", temp);
+        }
+
+        auto& output = files_[temp] = { {}, ++clock_, {} };
+        addToParents(temp);
+        return { std::move(temp), std::make_unique<StringAppendStream>(output.content) };
+    }
+
+    auto MemoryFileSystem::writeLock(fs::path const& target)
+        -> TempFile
+    {
+        auto lock = key(lockPath(target));
+        if (files_.contains(lock)) {
+            throw lockHeld(lock);
+        }
+
+        if (!directories_.contains(key(lock.parent_path()))) {
+            throw notFound("cannot create file", lock);
+        }
+
+        auto& output = files_[lock] = { {}, ++clock_, {} };
+        addToParents(lock);
+        return { std::move(lock), std::make_unique<StringAppendStream>(output.content) };
+    }
+
+    auto MemoryFileSystem::openAppend(fs::path const& path)
+        -> std::unique_ptr<std::ostream>
+    {
+        auto const fileKey = key(path);
+        if (!files_.contains(fileKey)) {
+            addFile(path, {});
+        }
+
+        auto& output = files_[fileKey];
+        output.modified = ++clock_;
+        return std::make_unique<StringAppendStream>(output.content);
+    }
+
+    void MemoryFileSystem::replace(
+            fs::path const& temp,
+            fs::path const& target
+        )
+    {
+        auto node = files_.extract(key(temp));
+        if (node.empty()) {
+            throw notFound("cannot rename", temp);
+        }
+
+        remove(temp);
+        node.key() = key(target);
+        files_.erase(node.key());
+        addToParents(node.key());
+        files_.insert(std::move(node));
+    }
+
+    void MemoryFileSystem::remove(fs::path const& path) noexcept
+    {
+        auto const pathKey = key(path);
+        files_.erase(pathKey);
+
+        auto parent = pathKey.parent_path();
+        if (auto const found = directories_.find(parent.empty() ? fs::path{WC("."sv)} : parent);
+                found != directories_.end() && !directories_.contains(pathKey)) {
+            found->second.erase(pathKey.filename());
+        }
+    }
+
+    void MemoryFileSystem::copy(
+            fs::path const& from,
+            fs::path const& to
+        )
+    {
+        addFile(to, content(from));
+    }
+
+    void MemoryFileSystem::link(
+            fs::path const& from,
+            fs::path const& to
+        )
+    {
+        if (files_.contains(key(to))) {
+            throw fs::filesystem_error("cannot create hard link", from, to,
+                    std::make_error_code(std::errc::file_exists));
+        }
+
+        // The files are replaced, not written in place, so a copy behaves like a link.
+        copy(from, to);
+    }
+
+    void MemoryFileSystem::createDirectories(fs::path const& path)
+    {
+        auto const directory = key(path);
+        if (files_.contains(directory)) {
+            throw fs::filesystem_error("cannot create directories", path,
+                    std::make_error_code(std::errc::not_a_directory));
+        }
+
+        directories_[directory];
+        addToParents(directory);
+    }
+
+    bool MemoryFileSystem::equivalent(
+            fs::path const& a,
+            fs::path const& b
+        ) noexcept
+    {
+        std::error_code ec;
+        auto const absoluteA = fs::absolute(a, ec);
+        auto const absoluteB = fs::absolute(b, ec);
+        return !ec && key(absoluteA) == key(absoluteB) && status(a).type != FileType::NotFound;
+    }
+
+    auto MemoryFileSystem::readAttribute(
+            fs::path const&     path,
+            std::string const&  name
+        ) -> std::optional<std::string>
+    {
+        auto const found = files_.find(key(path));
+        if (found == files_.end()) {
+            return std::nullopt;
+        }
+
+        auto const attribute = found->second.attributes.find(name);
+        if (attribute == found->second.attributes.end()) {
+            return std::nullopt;
+        }
+
+        return attribute->second;
+    }
+
+    bool MemoryFileSystem::writeAttribute(
+            fs::path const&     path,
+            std::string const&  name,
+            std::string_view    value
+        ) noexcept
+    {
+        try {
+            auto const found = files_.find(key(path));
+            if (found == files_.end()) {
+                return false;
+            }
+
+            found->second.attributes.insert_or_assign(name, std::string{value});
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_fileSystem()
+    {
+        int errors = 0;
+        auto check = [&errors](bool ok, std::string_view what)
+            {
+                if (!ok) {
+                    std::clog << "Test failed: MemoryFileSystem "sv << what << '\n';
+                    ++errors;
+                }
+            };
+
+        try {
+            MemoryFileSystem files;
+            files.addFile("src/a.c", "\tint a;\n");
+            files.addFile("src/b.c", "int b;\n");
+            files.addFile("src/sub/c.c", "\tint c;\n");
+            files.addFile("src/d.txt", "\td\n");
+
+            check(files.status("src").type == FileType::Directory
+               && files.status("src/a.c").type == FileType::Regular
+               && files.status("src/a.c").size == 8
+               && files.status("src/x.c").type == FileType::NotFound, "status");
+
+            auto const entries = files.list("src");
+            check(entries.size() == 4
+               && entries[0].path == "src/a.c" && entries[0].type == FileType::Regular
+               && entries[3].path == "src/sub" && entries[3].type == FileType::Directory, "list");
+
+            auto temp = files.writeTemp("src/b.c");
+            *temp.stream << "new";
+            temp.stream.reset();
+            files.replace(temp.path, "src/b.c");
+            check(files.list("src").size() == 4 && *files.file("src/b.c") == "new", "replace");
+
+            // The whole pipeline runs on the memory file system.
+            Config config;
+            config.directoryWalk = DirectoryWalk::Nested;
+            FileOptions options;
+            options.fileSystem = &files;
+
+            Report report;
+            tabsToSpaces("src/*.c", config, report, options);
+            check(*files.file("src/a.c") == "    int a;\n"
+               && *files.file("src/sub/c.c") == "    int c;\n"
+               && *files.file("src/d.txt") == "\td\n"
+               && report.files().size() == 3, "conversion");
+
+            options.outputDirectory = "out";
+            files.addFile("src/e.c", "\te\n");
+            tabsToSpaces("src/e.c", config, report, options);
+            tabsToSpaces("src/b.c", config, report, options);
+            check(*files.file("src/e.c") == "\te\n"
+               && *files.file("out/src/e.c") == "    e\n"
+               && *files.file("out/src/b.c") == "new", "output directory");
+
+            // Clean markers skip the files checked before with the same config.
+            MemoryFileSystem marked;
+            marked.addFile("m.c", "\tm\n");
+            marked.addFile("n.c", "n\n");
+            FileOptions markerOptions;
+            markerOptions.fileSystem   = &marked;
+            markerOptions.cleanMarkers = CleanMarkers::Use;
+
+            Report markerReport;
+            Config markerConfig;
+            tabsToSpaces("*.c", markerConfig, markerReport, markerOptions);
+            tabsToSpaces("*.c", markerConfig, markerReport, markerOptions);
+            marked.addFile("n.c", "\tn\n");
+            tabsToSpaces("*.c", markerConfig, markerReport, markerOptions);
+            markerConfig.tabWidth = 2;
+            tabsToSpaces("*.c", markerConfig, markerReport, markerOptions);
+
+            constexpr FileOutcome expected[]
+            {
+                FileOutcome::Converted, FileOutcome::Unchanged,
+                FileOutcome::Skipped,   FileOutcome::Skipped,
+                FileOutcome::Skipped,   FileOutcome::Converted,
+                FileOutcome::Unchanged, FileOutcome::Unchanged,
+            };
+
+            auto const& marks = markerReport.files();
+            check(std::ranges::equal(marks, expected, {}, &FileResult::outcome)
+               && marks[2].inputSize == 6
+               && *marked.file("n.c") == "    n\n"
+               && marked.readAttribute("m.c", "user.tabs2spaces").has_value()
+               && !marked.readAttribute("m.c", "user.other").has_value(), "clean markers");
+
+            // An output directory is written every time and its files are not marked.
+            markerOptions.outputDirectory = "out";
+            Report outReport;
+            marked.addFile("o.c", "\to\n");
+            tabsToSpaces("o.c", markerConfig, outReport, markerOptions);
+            marked.addFile("out/o.c", "stale\n");
+            tabsToSpaces("o.c", markerConfig, outReport, markerOptions);
+            check(outReport.files().size() == 2
+               && outReport.files()[1].outcome == FileOutcome::Converted
+               && *marked.file("out/o.c") == "  o\n"
+               && !marked.readAttribute("o.c", "user.tabs2spaces").has_value()
+               && !marked.readAttribute("out/o.c", "user.tabs2spaces").has_value(), "clean markers with an output directory");
+        } catch (std::exception const& e) {
+            std::clog << "Test failed: MemoryFileSystem: "sv << e.what() << '\n';
+            ++errors;
+        }
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
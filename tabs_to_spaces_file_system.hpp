@@ -0,0 +1,299 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_FILE_SYSTEM_HPP
+#define TABS_TO_SPACES_FILE_SYSTEM_HPP
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <functional>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <filesystem>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+
+namespace TabsToSpaces
+{
+
+    enum class FileType
+    {
+        NotFound,
+        Regular,
+        Directory,
+        Other,
+    };
+
+    struct FileStatus
+    {
+        FileType        type     = FileType::NotFound;
+        std::uintmax_t  size     = 0;   // of regular files
+        std::int64_t    modified = 0;   // last write time in nanoseconds
+    };
+
+    struct DirectoryEntry
+    {
+        std::filesystem::path   path;   // the directory path joined with the entry name
+        FileType                type = FileType::NotFound;
+    };
+
+    struct TempFile
+    {
+        std::filesystem::path           path;
+        std::unique_ptr<std::ostream>   stream;
+    };
+
+    // Storage processed files are read from and written to.
+    // Errors are reported by exceptions like those of std::filesystem.
+    class FileSystem
+    {
+    public:
+        virtual ~FileSystem() = default;
+
+        [[nodiscard]] virtual auto status(std::filesystem::path const& path)
+            -> FileStatus = 0;
+
+        // Entries of the directory. Symbolic links to directories are not directories here,
+        // so walking the tree does not follow them.
+        [[nodiscard]] virtual auto list(std::filesystem::path const& directory)
+            -> std::vector<DirectoryEntry> = 0;
+
+        // The whole content of the file.
+        [[nodiscard]] virtual auto read(std::filesystem::path const& path)
+            -> std::string = 0;
+
+        [[nodiscard]] virtual auto openRead(std::filesystem::path const& path)
+            -> std::unique_ptr<std::istream> = 0;
+
+        // Create a temporary file next to target to write its new content into.
+        [[nodiscard]] virtual auto writeTemp(std::filesystem::path const& target)
+            -> TempFile = 0;
+
+        // Create the lock file target.lock to write the new content of target into, as git does;
+        // replace commits it. Fails with std::errc::file_exists if another writer holds the lock.
+        [[nodiscard]] virtual auto writeLock(std::filesystem::path const& target)
+            -> TempFile = 0;
+
+        // Open the file to write at its end, creating it if missing.
+        [[nodiscard]] virtual auto openAppend(std::filesystem::path const& path)
+            -> std::unique_ptr<std::ostream> = 0;
+
+        // Replace target with the temporary file written completely.
+        virtual void replace(
+                std::filesystem::path const& temp,
+                std::filesystem::path const& target
+            ) = 0;
+
+        virtual void remove(std::filesystem::path const& path) noexcept = 0;
+
+        // Copy the file as is, replacing to by a new file as replace does.
+        virtual void copy(
+                std::filesystem::path const& from,
+                std::filesystem::path const& to
+            ) = 0;
+
+        // Make to another name of the file (a hard link). The files are never written in place,
+        // so the link keeps the content the file has now.
+        virtual void link(
+                std::filesystem::path const& from,
+                std::filesystem::path const& to
+            ) = 0;
+
+        virtual void createDirectories(std::filesystem::path const& path) = 0;
+
+        // Both paths exist and are the same file or directory.
+        [[nodiscard]] virtual bool equivalent(
+                std::filesystem::path const& a,
+                std::filesystem::path const& b
+            ) noexcept = 0;
+
+        // Small named value kept with the file (an extended attribute) or nullopt
+        // if there is none or the file system does not support them.
+        [[nodiscard]] virtual auto readAttribute(
+                std::filesystem::path const& path,
+                std::string const&           name
+            ) -> std::optional<std::string> = 0;
+
+        // False if the value could not be stored, e.g. the file system does not support attributes.
+        // Storing it does not change the last write time.
+        virtual bool writeAttribute(
+                std::filesystem::path const& path,
+                std::string const&           name,
+                std::string_view             value
+            ) noexcept = 0;
+    };
+
+    // Files of the operating system: std::filesystem and streams, using POSIX calls on Linux
+    // to stat, to clone unchanged files (reflink, then copy_file_range) and for attributes
+    // (user extended attributes; elsewhere attributes are not supported).
+    class NativeFileSystem final
+        : public FileSystem
+    {
+    public:
+        auto status(std::filesystem::path const& path)
+            -> FileStatus override;
+
+        auto list(std::filesystem::path const& directory)
+            -> std::vector<DirectoryEntry> override;
+
+        auto read(std::filesystem::path const& path)
+            -> std::string override;
+
+        auto openRead(std::filesystem::path const& path)
+            -> std::unique_ptr<std::istream> override;
+
+        auto writeTemp(std::filesystem::path const& target)
+            -> TempFile override;
+
+        auto writeLock(std::filesystem::path const& target)
+            -> TempFile override;
+
+        auto openAppend(std::filesystem::path const& path)
+            -> std::unique_ptr<std::ostream> override;
+
+        void replace(
+                std::filesystem::path const& temp,
+                std::filesystem::path const& target
+            ) override;
+
+        void remove(std::filesystem::path const& path) noexcept override;
+
+        void copy(
+                std::filesystem::path const& from,
+                std::filesystem::path const& to
+            ) override;
+
+        void link(
+                std::filesystem::path const& from,
+                std::filesystem::path const& to
+            ) override;
+
+        void createDirectories(std::filesystem::path const& path) override;
+
+        bool equivalent(
+                std::filesystem::path const& a,
+                std::filesystem::path const& b
+            ) noexcept override;
+
+        auto readAttribute(
+                std::filesystem::path const& path,
+                std::string const&           name
+            ) -> std::optional<std::string> override;
+
+        bool writeAttribute(
+                std::filesystem::path const& path,
+                std::string const&           name,
+                std::string_view             value
+            ) noexcept override;
+    };
+
+    // The file system used unless another one is given.
+    [[nodiscard]] auto nativeFileSystem() noexcept
+        -> NativeFileSystem&;
+
+    // Files kept in memory, e.g. to measure processing without storage costs.
+    // Paths are compared after lexical normalization, relative ones are under ".".
+    // Modified times count the writes.
+    class MemoryFileSystem final
+        : public FileSystem
+    {
+    public:
+        // Add or overwrite a file creating its parent directories.
+        void addFile(
+                std::filesystem::path const& path,
+                std::string                  content
+            );
+
+        // Content of the file or null if there is no such file.
+        [[nodiscard]] auto file(std::filesystem::path const& path) const
+            -> std::string const*;
+
+        auto status(std::filesystem::path const& path)
+            -> FileStatus override;
+
+        auto list(std::filesystem::path const& directory)
+            -> std::vector<DirectoryEntry> override;
+
+        auto read(std::filesystem::path const& path)
+            -> std::string override;
+
+        auto openRead(std::filesystem::path const& path)
+            -> std::unique_ptr<std::istream> override;
+
+        auto writeTemp(std::filesystem::path const& target)
+            -> TempFile override;
+
+        auto writeLock(std::filesystem::path const& target)
+            -> TempFile override;
+
+        auto openAppend(std::filesystem::path const& path)
+            -> std::unique_ptr<std::ostream> override;
+
+        void replace(
+                std::filesystem::path const& temp,
+                std::filesystem::path const& target
+            ) override;
+
+        void remove(std::filesystem::path const& path) noexcept override;
+
+        void copy(
+                std::filesystem::path const& from,
+                std::filesystem::path const& to
+            ) override;
+
+        void link(
+                std::filesystem::path const& from,
+                std::filesystem::path const& to
+            ) override;
+
+        void createDirectories(std::filesystem::path const& path) override;
+
+        bool equivalent(
+                std::filesystem::path const& a,
+                std::filesystem::path const& b
+            ) noexcept override;
+
+        auto readAttribute(
+                std::filesystem::path const& path,
+                std::string const&           name
+            ) -> std::optional<std::string> override;
+
+        bool writeAttribute(
+                std::filesystem::path const& path,
+                std::string const&           name,
+                std::string_view             value
+            ) noexcept override;
+
+    private:
+        [[nodiscard]] static auto key(std::filesystem::path const& path)
+            -> std::filesystem::path;
+
+        struct File
+        {
+            std::string                                         content;
+            std::int64_t                                        modified = 0;
+            std::map<std::string, std::string, std::less<>>     attributes;
+        };
+
+        [[nodiscard]] auto content(std::filesystem::path const& path) const
+            -> std::string const&;
+
+        // Register the entry in its parent directory and the parents in theirs.
+        void addToParents(std::filesystem::path const& key);
+
+        std::map<std::filesystem::path, File>                               files_;
+        std::map<std::filesystem::path, std::set<std::filesystem::path>>   directories_;  // entry names
+        std::int64_t                                                        clock_ = 0;    // for modified times
+    };
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_fileSystem();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_FILE_SYSTEM_HPP
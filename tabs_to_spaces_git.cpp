@@ -0,0 +1,1340 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_git.hpp"
+#include "tabs_to_spaces_file_system.hpp"
+#include "tabs_to_spaces_compressed.hpp"
+#include "tabs_to_spaces_blake3.hpp"
+#include "tabs_to_spaces_stats.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <bit>
+#include <cstdlib>
+#include <exception>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+// Git objects are zlib streams: reading them needs the gzip codec build (TABS_TO_SPACES_GZIP, linking zlib).
+#ifdef  TABS_TO_SPACES_GZIP
+#define ZLIB_CONST
+#include <zlib.h>
+#endif//TABS_TO_SPACES_GZIP
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+    namespace fs = std::filesystem;
+
+    namespace
+    {
+
+        // SHA-1 for object names and the index checksum.
+        class Sha1
+        {
+        public:
+            void update(std::string_view data) noexcept
+            {
+                length_ += data.size();
+                for (auto in : data) {
+                    block_[blockLength_++] = static_cast<std::uint8_t>(in);
+                    if (blockLength_ == block_.size()) {
+                        compress();
+                        blockLength_ = 0;
+                    }
+                }
+            }
+
+            [[nodiscard]] auto digest() const noexcept
+                -> GitObjectId
+            {
+                auto final = *this;
+                auto const bits = length_ * 8;
+
+                final.update("\x80"sv);
+                while (final.blockLength_ != 56) {
+                    final.update("\0"sv);
+                }
+
+                for (int shift = 56; shift >= 0; shift -= 8) {
+                    final.block_[final.blockLength_++] = static_cast<std::uint8_t>(bits >> shift);
+                }
+
+                final.compress();
+
+                GitObjectId id;
+                for (std::size_t i = 0; i < id.size(); ++i) {
+                    id[i] = static_cast<std::uint8_t>(final.state_[i / 4] >> (24 - 8 * (i % 4)));
+                }
+
+                return id;
+            }
+
+        private:
+            void compress() noexcept
+            {
+                std::array<std::uint32_t, 80> w;
+                for (std::size_t i = 0; i < 16; ++i) {
+                    w[i] = std::uint32_t{block_[4 * i]} << 24 | std::uint32_t{block_[4 * i + 1]} << 16
+                         | std::uint32_t{block_[4 * i + 2]} << 8 | std::uint32_t{block_[4 * i + 3]};
+                }
+
+                for (std::size_t i = 16; i < w.size(); ++i) {
+                    w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+                }
+
+                auto [a, b, c, d, e] = state_;
+                for (std::size_t i = 0; i < w.size(); ++i) {
+                    std::uint32_t f;
+                    std::uint32_t k;
+                    if (i < 20) {
+                        f = (b & c) | (~b & d);
+                        k = 0x5A827999;
+                    } else if (i < 40) {
+                        f = b ^ c ^ d;
+                        k = 0x6ED9EBA1;
+                    } else if (i < 60) {
+                        f = (b & c) | (b & d) | (c & d);
+                        k = 0x8F1BBCDC;
+                    } else {
+                        f = b ^ c ^ d;
+                        k = 0xCA62C1D6;
+                    }
+
+                    auto const temp = std::rotl(a, 5) + f + e + k + w[i];
+                    e = d;
+                    d = c;
+                    c = std::rotl(b, 30);
+                    b = a;
+                    a = temp;
+                }
+
+                state_[0] += a;
+                state_[1] += b;
+                state_[2] += c;
+                state_[3] += d;
+                state_[4] += e;
+            }
+
+            std::array<std::uint32_t, 5>    state_ { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+            std::array<std::uint8_t, 64>    block_ {};
+            std::size_t                     blockLength_ = 0;
+            std::uint64_t                   length_      = 0;
+        };
+
+        [[nodiscard]] auto corrupt(std::string_view what)
+            -> std::runtime_error
+        {
+            return std::runtime_error("Corrupt git data: "s + std::string{what});
+        }
+
+        [[nodiscard]] auto parseId(std::string_view hex)
+            -> std::optional<GitObjectId>
+        {
+            auto digit = [](char ch) -> int
+                {
+                    if (ch >= '0' && ch <= '9') {
+                        return ch - '0';
+                    }
+
+                    return ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+                };
+
+            GitObjectId id;
+            if (hex.size() != 2 * id.size()) {
+                return std::nullopt;
+            }
+
+            for (std::size_t i = 0; i < id.size(); ++i) {
+                auto const high = digit(hex[2 * i]);
+                auto const low  = digit(hex[2 * i + 1]);
+                if (high < 0 || low < 0) {
+                    return std::nullopt;
+                }
+
+                id[i] = static_cast<std::uint8_t>(high << 4 | low);
+            }
+
+            return id;
+        }
+
+        [[nodiscard]] auto idAt(
+                std::string_view    data,
+                std::size_t         offset
+            ) -> GitObjectId
+        {
+            GitObjectId id;
+            if (offset + id.size() > data.size()) {
+                throw corrupt("object name past the end"sv);
+            }
+
+            std::ranges::copy(data.substr(offset, id.size()), id.begin());
+            return id;
+        }
+
+        [[nodiscard]] auto bigEndian(
+                std::string_view    data,
+                std::size_t         offset,
+                std::size_t         size
+            ) -> std::uint64_t
+        {
+            if (offset + size > data.size()) {
+                throw corrupt("field past the end"sv);
+            }
+
+            std::uint64_t value = 0;
+            for (auto byte : data.substr(offset, size)) {
+                value = value << 8 | static_cast<std::uint8_t>(byte);
+            }
+
+            return value;
+        }
+
+        // "ref: name" or a hex object name ending with a new-line.
+        [[nodiscard]] auto trimLine(std::string_view text) noexcept
+            -> std::string_view
+        {
+            while (!text.empty() && (text.back() == '\n' || text.back() == '\r' || text.back() == ' ')) {
+                text.remove_suffix(1);
+            }
+
+            return text;
+        }
+
+        [[nodiscard]] auto fromUtf8(std::string_view text)
+            -> fs::path
+        {
+            return std::u8string{ text.begin(), text.end() };
+        }
+
+        [[nodiscard]] auto objectType(std::string_view name)
+            -> GitObjectType
+        {
+            if (name == "blob"sv) {
+                return GitObjectType::Blob;
+            } else if (name == "tree"sv) {
+                return GitObjectType::Tree;
+            } else if (name == "commit"sv) {
+                return GitObjectType::Commit;
+            } else if (name == "tag"sv) {
+                return GitObjectType::Tag;
+            }
+
+            throw corrupt("object type "s + std::string{name});
+        }
+
+        [[nodiscard]] auto toString(GitObjectType type) noexcept
+            -> std::string_view
+        {
+            switch (type) {
+            case GitObjectType::Commit: return "commit"sv;
+            case GitObjectType::Tree:   return "tree"sv;
+            case GitObjectType::Blob:   return "blob"sv;
+            case GitObjectType::Tag:    return "tag"sv;
+            }
+
+            return "unknown"sv;
+        }
+
+        // Object content after "type size\0".
+        [[nodiscard]] auto objectHeader(
+                GitObjectType   type,
+                std::size_t     size
+            ) -> std::string
+        {
+            return std::string{toString(type)} + ' ' + std::to_string(size) + '\0';
+        }
+
+        // Size of inflated data if it is not known in advance.
+        constexpr std::size_t unknownSize = static_cast<std::size_t>(-1);
+
+        // Inflate a zlib stream from the compressed blocks source() returns (empty at the end).
+        template <typename Source>
+        [[nodiscard]] auto inflateZlib(
+                Source&&        source,
+                std::size_t     size
+            ) -> std::string
+        {
+        #ifdef  TABS_TO_SPACES_GZIP
+            z_stream stream {};
+            if (inflateInit(&stream) != Z_OK) {
+                throw std::runtime_error("zlib initialization failed");
+            }
+
+            std::unique_ptr<z_stream, decltype(&inflateEnd)> const end(&stream, &inflateEnd);
+
+            // One byte more than the known size lets the stream end be consumed.
+            std::string output(size == unknownSize ? 4096 : size + 1, '\0');
+            std::size_t produced = 0;
+            for (int status = Z_OK; status != Z_STREAM_END; ) {
+                if (stream.avail_in == 0) {
+                    std::string_view const input = source();
+                    if (input.empty()) {
+                        throw corrupt("truncated zlib stream"sv);
+                    }
+
+                    stream.next_in  = reinterpret_cast<Bytef const*>(input.data());
+                    stream.avail_in = static_cast<uInt>(input.size());
+                }
+
+                if (produced == output.size()) {
+                    if (size != unknownSize) {
+                        throw corrupt("object larger than its size"sv);
+                    }
+
+                    output.resize(2 * output.size());
+                }
+
+                stream.next_out  = reinterpret_cast<Bytef*>(output.data() + produced);
+                stream.avail_out = static_cast<uInt>(output.size() - produced);
+                status = inflate(&stream, Z_NO_FLUSH);
+                if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+                    throw corrupt("invalid zlib stream"sv);
+                }
+
+                produced = output.size() - stream.avail_out;
+            }
+
+            if (size != unknownSize && produced != size) {
+                throw corrupt("object smaller than its size"sv);
+            }
+
+            output.resize(produced);
+            return output;
+        #else
+            static_cast<void>(source);
+            static_cast<void>(size);
+            throw std::runtime_error("Git objects need zlib which is not in this build (see TABS_TO_SPACES_GZIP)");
+        #endif//TABS_TO_SPACES_GZIP
+        }
+
+        [[nodiscard]] auto deflateZlib(std::string_view data)
+            -> std::string
+        {
+        #ifdef  TABS_TO_SPACES_GZIP
+            auto size = compressBound(static_cast<uLong>(data.size()));
+            std::string output(size, '\0');
+            if (compress(reinterpret_cast<Bytef*>(output.data()), &size,
+                    reinterpret_cast<Bytef const*>(data.data()), static_cast<uLong>(data.size())) != Z_OK) {
+                throw std::runtime_error("zlib compression failed");
+            }
+
+            output.resize(size);
+            return output;
+        #else
+            static_cast<void>(data);
+            throw std::runtime_error("Git objects need zlib which is not in this build (see TABS_TO_SPACES_GZIP)");
+        #endif//TABS_TO_SPACES_GZIP
+        }
+
+        // Apply a git delta: the sizes of the base and the result, then copy and insert instructions.
+        [[nodiscard]] auto applyDelta(
+                std::string_view base,
+                std::string_view delta
+            ) -> std::string
+        {
+            auto next = [&delta]
+                {
+                    if (delta.empty()) {
+                        throw corrupt("truncated delta"sv);
+                    }
+
+                    auto const byte = static_cast<std::uint8_t>(delta.front());
+                    delta.remove_prefix(1);
+                    return byte;
+                };
+
+            auto size = [&next]
+                {
+                    std::uint64_t value = 0;
+                    for (int shift = 0; ; shift += 7) {
+                        auto const byte = next();
+                        value |= std::uint64_t{byte & 0x7Fu} << shift;
+                        if ((byte & 0x80) == 0 || shift > 56) {
+                            return value;
+                        }
+                    }
+                };
+
+            if (size() != base.size()) {
+                throw corrupt("delta base size"sv);
+            }
+
+            auto const resultSize = size();
+            std::string result;
+            result.reserve(static_cast<std::size_t>(resultSize));
+            while (!delta.empty()) {
+                auto const command = next();
+                if ((command & 0x80) != 0) {
+                    std::uint64_t offset = 0;
+                    std::uint64_t length = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        if ((command & (1 << i)) != 0) {
+                            offset |= std::uint64_t{next()} << (8 * i);
+                        }
+                    }
+
+                    for (int i = 0; i < 3; ++i) {
+                        if ((command & (0x10 << i)) != 0) {
+                            length |= std::uint64_t{next()} << (8 * i);
+                        }
+                    }
+
+                    if (length == 0) {
+                        length = 0x10000;
+                    }
+
+                    if (offset + length > base.size()) {
+                        throw corrupt("delta copy past the base"sv);
+                    }
+
+                    result += base.substr(static_cast<std::size_t>(offset), static_cast<std::size_t>(length));
+                } else if (command != 0) {
+                    if (command > delta.size()) {
+                        throw corrupt("truncated delta"sv);
+                    }
+
+                    result += delta.substr(0, command);
+                    delta.remove_prefix(command);
+                } else {
+                    throw corrupt("delta instruction"sv);
+                }
+            }
+
+            if (result.size() != resultSize) {
+                throw corrupt("delta result size"sv);
+            }
+
+            return result;
+        }
+
+        // The number of the offset encoding of pack deltas and index version 4 paths:
+        // each continuation adds one before shifting, so every value has one encoding.
+        [[nodiscard]] auto offsetNumber(
+                std::string_view    data,
+                std::size_t&        position
+            ) -> std::uint64_t
+        {
+            auto next = [&]
+                {
+                    if (position >= data.size()) {
+                        throw corrupt("truncated number"sv);
+                    }
+
+                    return static_cast<std::uint8_t>(data[position++]);
+                };
+
+            auto byte = next();
+            std::uint64_t value = byte & 0x7F;
+            while ((byte & 0x80) != 0) {
+                byte  = next();
+                value = ((value + 1) << 7) | (byte & 0x7F);
+            }
+
+            return value;
+        }
+
+        constexpr int maxDeltaDepth = 10000;
+
+        // Delta bases kept by a reader; it is emptied when it grows larger.
+        constexpr std::size_t baseCacheSize = std::size_t{32} << 20;
+
+        constexpr std::size_t packReadSize = std::size_t{64} << 10;
+
+        enum : int
+        {
+            packOffsetDelta    = 6,
+            packReferenceDelta = 7,
+        };
+
+    }
+
+
+    auto toHex(GitObjectId const& id)
+        -> std::string
+    {
+        constexpr char hex[] = "0123456789abcdef";
+
+        std::string result;
+        result.reserve(2 * id.size());
+        for (auto byte : id) {
+            result += hex[byte >> 4];
+            result += hex[byte & 0xF];
+        }
+
+        return result;
+    }
+
+    auto findGitDirectory(fs::path const& directory)
+        -> fs::path
+    {
+        if (auto const gitDir = std::getenv("GIT_DIR"); gitDir != nullptr && *gitDir != '\0') {
+            return fs::path{gitDir};
+        }
+
+        auto& files = nativeFileSystem();
+        for (auto current = directory; ; current = current.parent_path()) {
+            auto const dotGit = current / ".git";
+            auto const status = files.status(dotGit);
+            if (status.type == FileType::Directory) {
+                return dotGit;
+            }
+
+            if (status.type == FileType::Regular) {
+                // "gitdir: path" relative to the directory of the file.
+                auto const text = files.read(dotGit);
+                auto const line = trimLine(std::string_view{text}.substr(0, text.find('\n')));
+                if (!line.starts_with("gitdir: "sv)) {
+                    throw std::runtime_error("Invalid .git file: "s + dotGit.string());
+                }
+
+                return current / fromUtf8(line.substr("gitdir: "sv.size()));
+            }
+
+            if (current == current.parent_path() || current.empty()) {
+                throw std::runtime_error("Not in a git repository: "s + directory.string());
+            }
+        }
+    }
+
+
+    GitRepository::GitRepository(
+            fs::path    gitDirectory,
+            FileSystem* fileSystem
+        )
+        : fileSystem_(fileSystem != nullptr ? *fileSystem : nativeFileSystem())
+        , gitDirectory_(std::move(gitDirectory))
+        , commonDirectory_(gitDirectory_)
+    {
+        // Linked worktrees keep the objects and references in the common directory.
+        if (auto const commondir = gitDirectory_ / "commondir"; fileSystem_.status(commondir).type == FileType::Regular) {
+            commonDirectory_ = gitDirectory_ / fromUtf8(trimLine(fileSystem_.read(commondir)));
+        }
+
+        if (auto const config = commonDirectory_ / "config"; fileSystem_.status(config).type == FileType::Regular) {
+            auto const text = fileSystem_.read(config);
+            if (auto const format = text.find("objectformat"sv);
+                    format != text.npos && text.find("sha256"sv, format) < text.find('\n', format)) {
+                throw std::runtime_error("SHA-256 git repositories are not supported: "s + gitDirectory_.string());
+            }
+        }
+
+        auto const packDirectory = commonDirectory_ / "objects" / "pack";
+        if (fileSystem_.status(packDirectory).type != FileType::Directory) {
+            return;
+        }
+
+        for (auto const& entry : fileSystem_.list(packDirectory)) {
+            if (entry.type != FileType::Regular || entry.path.extension() != ".idx") {
+                continue;
+            }
+
+            Pack pack;
+            pack.path  = fs::path{entry.path}.replace_extension(".pack");
+            pack.index = fileSystem_.read(entry.path);
+
+            // Version 2: magic, version, 256 fan-out counts, names, CRCs, offsets.
+            constexpr std::size_t fanout = 8;
+            if (!pack.index.starts_with("\xFFtOc\0\0\0\x02"sv)) {
+                throw std::runtime_error("Unsupported pack index: "s + entry.path.string());
+            }
+
+            pack.count = static_cast<std::uint32_t>(bigEndian(pack.index, fanout + 255 * 4, 4));
+            if (pack.index.size() < fanout + 256 * 4 + std::size_t{pack.count} * (20 + 4 + 4) + 2 * 20) {
+                throw corrupt(entry.path.string());
+            }
+
+            packs_.push_back(std::move(pack));
+        }
+    }
+
+    auto GitRepository::findPacked(GitObjectId const& id) const noexcept
+        -> std::optional<PackLocation>
+    {
+        constexpr std::size_t fanout = 8;
+        constexpr std::size_t names  = fanout + 256 * 4;
+
+        for (std::size_t i = 0; i < packs_.size(); ++i) {
+            std::string_view const index = packs_[i].index;
+            auto const count = std::size_t{packs_[i].count};
+            auto fanoutCount = [&](std::size_t byte)
+                {
+                    return static_cast<std::size_t>(bigEndian(index, fanout + 4 * byte, 4));
+                };
+
+            auto first = id[0] == 0 ? std::size_t{0} : fanoutCount(id[0] - 1u);
+            auto last  = fanoutCount(id[0]);
+            std::string_view const name{ reinterpret_cast<char const*>(id.data()), id.size() };
+            while (first < last) {
+                auto const middle = first + (last - first) / 2;
+                auto const order  = index.substr(names + 20 * middle, 20).compare(name);
+                if (order < 0) {
+                    first = middle + 1;
+                } else if (order > 0) {
+                    last = middle;
+                } else {
+                    // A set high bit selects an entry of the table of 64-bit offsets.
+                    auto const offsets = names + count * (20 + 4);
+                    auto offset = bigEndian(index, offsets + 4 * middle, 4);
+                    if ((offset & 0x80000000) != 0) {
+                        offset = bigEndian(index, offsets + 4 * count + 8 * (offset & 0x7FFFFFFF), 8);
+                    }
+
+                    return PackLocation{ i, offset };
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    auto GitRepository::looseObjectPath(GitObjectId const& id) const
+        -> fs::path
+    {
+        auto const hex = toHex(id);
+        return commonDirectory_ / "objects" / hex.substr(0, 2) / hex.substr(2);
+    }
+
+    auto GitRepository::readReference(
+            std::string const&  name,
+            int                 depth
+        ) const -> std::optional<GitObjectId>
+    {
+        if (depth > 5) {
+            throw std::runtime_error("Symbolic reference loop: "s + name);
+        }
+
+        // HEAD is per worktree, the others are shared.
+        auto const file = (name == "HEAD"sv ? gitDirectory_ : commonDirectory_) / fromUtf8(name);
+        if (fileSystem_.status(file).type == FileType::Regular) {
+            auto const text = fileSystem_.read(file);
+            auto const line = trimLine(text);
+            if (line.starts_with("ref: "sv)) {
+                return readReference(std::string{line.substr("ref: "sv.size())}, depth + 1);
+            }
+
+            if (auto const id = parseId(line)) {
+                return id;
+            }
+
+            throw corrupt(file.string());
+        }
+
+        // "id name" lines; "^id" lines peel the tag above them.
+        if (auto const packedRefs = commonDirectory_ / "packed-refs"; fileSystem_.status(packedRefs).type == FileType::Regular) {
+            auto const text = fileSystem_.read(packedRefs);
+            for (std::string_view rest{text}; !rest.empty(); ) {
+                auto const line = trimLine(rest.substr(0, rest.find('\n')));
+                rest.remove_prefix(std::min(rest.size(), rest.find('\n') + 1));
+                if (line.size() > 41 && line[40] == ' ' && line.substr(41) == name) {
+                    return parseId(line.substr(0, 40));
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    auto GitRepository::resolve(std::string_view revision) const
+        -> GitObjectId
+    {
+        if (auto const id = parseId(revision)) {
+            return *id;
+        }
+
+        // The order of git rev-parse.
+        std::string const name{revision};
+        for (auto const& candidate : { name, "refs/"s + name, "refs/tags/"s + name, "refs/heads/"s + name,
+                                       "refs/remotes/"s + name, "refs/remotes/"s + name + "/HEAD"s }) {
+            if (candidate.find("..") != candidate.npos) {
+                break;
+            }
+
+            if (auto const id = readReference(candidate, 0)) {
+                return *id;
+            }
+        }
+
+        throw std::invalid_argument("Unknown git revision: "s + name);
+    }
+
+    auto GitRepository::readObject(GitObjectId const& id) const
+        -> GitObject
+    {
+        return Reader{*this}.read(id);
+    }
+
+    auto GitRepository::treeBlobs(GitObjectId const& id) const
+        -> std::vector<GitBlob>
+    {
+        Reader reader{*this};
+
+        // Peel tags and commits to the tree.
+        auto object = reader.read(id);
+        for (int depth = 0; object.type != GitObjectType::Tree; ++depth) {
+            std::string_view const field = object.type == GitObjectType::Commit ? "tree "sv : "object "sv;
+            if (object.type == GitObjectType::Blob || depth > 100 || !object.data.starts_with(field)) {
+                throw std::invalid_argument("Not a commit or a tree: "s + toHex(id));
+            }
+
+            auto const target = parseId(std::string_view{object.data}.substr(field.size(), 40));
+            if (!target) {
+                throw corrupt(toHex(id));
+            }
+
+            object = reader.read(*target);
+        }
+
+        std::vector<GitBlob> blobs;
+        auto walk = [&](auto const& self, std::string_view tree, std::string const& prefix) -> void
+            {
+                // "mode name\0" and the binary object name.
+                while (!tree.empty()) {
+                    auto const space = tree.find(' ');
+                    auto const zero  = tree.find('\0');
+                    if (space == tree.npos || zero == tree.npos || space > zero) {
+                        throw corrupt("tree entry"sv);
+                    }
+
+                    auto const mode  = tree.substr(0, space);
+                    auto const path  = prefix + std::string{tree.substr(space + 1, zero - space - 1)};
+                    auto const entry = idAt(tree, zero + 1);
+                    tree.remove_prefix(zero + 1 + entry.size());
+
+                    if (mode == "40000"sv) {
+                        auto const subtree = reader.read(entry);
+                        if (subtree.type != GitObjectType::Tree) {
+                            throw corrupt("tree entry type"sv);
+                        }
+
+                        self(self, subtree.data, path + '/');
+                    } else if (mode == "100644"sv || mode == "100755"sv) {
+                        blobs.push_back({ path, entry, 0 });
+                    }
+                }
+            };
+
+        walk(walk, object.data, {});
+        std::ranges::sort(blobs, {}, &GitBlob::path);
+        return blobs;
+    }
+
+    auto GitRepository::readIndex()
+        -> std::vector<GitBlob>
+    {
+        index_ = fileSystem_.read(gitDirectory_ / "index");
+        std::string_view const index{index_};
+
+        constexpr std::size_t headerSize = 12;
+        constexpr std::size_t statSize   = 40;      // times, device, inode, mode, ids, size
+        constexpr std::size_t fixedSize  = statSize + 20 + 2;
+
+        if (!index.starts_with("DIRC"sv) || index.size() < headerSize + 20) {
+            throw corrupt("index header"sv);
+        }
+
+        auto const version = bigEndian(index, 4, 4);
+        if (version < 2 || version > 4) {
+            throw std::runtime_error("Unsupported git index version: "s + std::to_string(version));
+        }
+
+        auto const count = bigEndian(index, 8, 4);
+        std::vector<GitBlob> blobs;
+        std::string path;
+        auto position = headerSize;
+        for (std::uint64_t i = 0; i < count; ++i) {
+            auto const entry = position;
+            auto const mode  = bigEndian(index, entry + 24, 4);
+            auto const flags = bigEndian(index, entry + statSize + 20, 2);
+            position += fixedSize + ((flags & 0x4000) != 0 ? 2 : 0);
+
+            // Version 4 strips a number of bytes from the previous path and appends the rest.
+            if (version == 4) {
+                auto const strip = offsetNumber(index, position);
+                if (strip > path.size()) {
+                    throw corrupt("index path"sv);
+                }
+
+                path.resize(path.size() - static_cast<std::size_t>(strip));
+            } else {
+                path.clear();
+            }
+
+            auto const end = index.find('\0', position);
+            if (end == index.npos) {
+                throw corrupt("index path"sv);
+            }
+
+            path += index.substr(position, end - position);
+            position = version == 4 ? end + 1 : entry + ((end - entry + 8) & ~std::size_t{7});
+
+            // Regular files merged at stage 0 only.
+            if ((mode & 0170000) == 0100000 && (flags & 0x3000) == 0) {
+                blobs.push_back({ path, idAt(index, entry + statSize), entry });
+            }
+        }
+
+        indexEntriesEnd_ = position;
+        for (auto extension = position; extension + 8 <= index.size() - 20; ) {
+            if (index.substr(extension, 4) == "link"sv) {
+                throw std::runtime_error("Split git index is not supported");
+            }
+
+            extension += 8 + static_cast<std::size_t>(bigEndian(index, extension + 4, 4));
+        }
+
+        return blobs;
+    }
+
+    auto GitRepository::writeObject(
+            GitObjectType       type,
+            std::string_view    data
+        ) -> GitObjectId
+    {
+        auto object = objectHeader(type, data.size());
+        object += data;
+
+        Sha1 hash;
+        hash.update(object);
+        auto const id   = hash.digest();
+        auto const path = looseObjectPath(id);
+
+        auto const compressed = deflateZlib(object);
+        std::scoped_lock lock(writeMutex_);
+        if (fileSystem_.status(path).type == FileType::NotFound && !findPacked(id)) {
+            fileSystem_.createDirectories(path.parent_path());
+            auto file = fileSystem_.writeTemp(path);
+            try {
+                file.stream->write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+                if (!file.stream->flush()) {
+                    throw std::runtime_error("File write failed: "s + file.path.string());
+                }
+
+                file.stream.reset();
+            } catch (...) {
+                file.stream.reset();
+                fileSystem_.remove(file.path);
+                throw;
+            }
+
+            fileSystem_.replace(file.path, path);
+        }
+
+        return id;
+    }
+
+    void GitRepository::writeIndex(std::span<GitBlob const> changed)
+    {
+        if (changed.empty()) {
+            return;
+        }
+
+        // The entries with new object names and cleared sizes.
+        std::string index = index_.substr(0, indexEntriesEnd_);
+        for (auto const& blob : changed) {
+            if (blob.indexEntry == 0 || blob.indexEntry + 62 > indexEntriesEnd_) {
+                throw std::invalid_argument("Not an index blob: "s + blob.path);
+            }
+
+            std::ranges::copy(blob.id, index.begin() + static_cast<std::ptrdiff_t>(blob.indexEntry + 40));
+            std::fill_n(index.begin() + static_cast<std::ptrdiff_t>(blob.indexEntry + 36), 4, '\0');
+        }
+
+        // The cached trees are stale now, the end of entries extension checksums them
+        // and the file system monitor token would let git trust the old entries of the work tree.
+        std::string_view const extensions = std::string_view{index_}.substr(indexEntriesEnd_, index_.size() - 20 - indexEntriesEnd_);
+        for (std::size_t extension = 0; extension + 8 <= extensions.size(); ) {
+            auto const size = 8 + static_cast<std::size_t>(bigEndian(extensions, extension + 4, 4));
+            auto const signature = extensions.substr(extension, 4);
+            if (signature != "TREE"sv && signature != "EOIE"sv && signature != "FSMN"sv) {
+                index += extensions.substr(extension, size);
+            }
+
+            extension += size;
+        }
+
+        Sha1 hash;
+        hash.update(index);
+        auto const checksum = hash.digest();
+        index.append(reinterpret_cast<char const*>(checksum.data()), checksum.size());
+
+        // Git's lock protocol: index.lock is created exclusively, so a running git command makes this fail,
+        // and the index read before must not have changed since.
+        auto file = fileSystem_.writeLock(gitDirectory_ / "index");
+        try {
+            if (fileSystem_.read(gitDirectory_ / "index") != index_) {
+                throw std::runtime_error("Git index changed while converting: "s + (gitDirectory_ / "index").string());
+            }
+
+            file.stream->write(index.data(), static_cast<std::streamsize>(index.size()));
+            if (!file.stream->flush()) {
+                throw std::runtime_error("File write failed: "s + file.path.string());
+            }
+
+            file.stream.reset();
+            fileSystem_.replace(file.path, gitDirectory_ / "index");
+        } catch (...) {
+            file.stream.reset();
+            fileSystem_.remove(file.path);     // the lock is released
+            throw;
+        }
+
+        index_ = std::move(index);
+    }
+
+
+    GitRepository::Reader::Reader(GitRepository const& repository) noexcept
+        : repository_(repository)
+    {
+    }
+
+    auto GitRepository::Reader::read(GitObjectId const& id)
+        -> GitObject
+    {
+        if (auto const packed = repository_.findPacked(id)) {
+            return readPacked(packed->pack, packed->offset, 0);
+        }
+
+        auto const path = repository_.looseObjectPath(id);
+        if (repository_.fileSystem_.status(path).type != FileType::Regular) {
+            throw std::runtime_error("Git object not found: "s + toHex(id));
+        }
+
+        auto const compressed = repository_.fileSystem_.read(path);
+        bool given = false;
+        auto object = inflateZlib([&]
+            {
+                return std::exchange(given, true) ? std::string_view{} : std::string_view{compressed};
+            }, unknownSize);
+
+        // "type size\0content"
+        auto const space = object.find(' ');
+        auto const zero  = object.find('\0');
+        if (space == object.npos || zero == object.npos || space > zero
+         || std::to_string(object.size() - zero - 1) != std::string_view{object}.substr(space + 1, zero - space - 1)) {
+            throw corrupt(path.string());
+        }
+
+        auto const type = objectType(std::string_view{object}.substr(0, space));
+        object.erase(0, zero + 1);
+        return { type, std::move(object) };
+    }
+
+    auto GitRepository::Reader::readPacked(
+            std::size_t     pack,
+            std::uint64_t   offset,
+            int             depth
+        ) -> GitObject
+    {
+        if (auto const cached = bases_.find({ pack, offset }); cached != bases_.end()) {
+            return cached->second;
+        }
+
+        if (depth > maxDeltaDepth) {
+            throw corrupt("delta chain too long"sv);
+        }
+
+        if (packs_.size() < repository_.packs_.size()) {
+            packs_.resize(repository_.packs_.size());
+        }
+
+        auto& input = packs_[pack];
+        if (!input) {
+            input = repository_.fileSystem_.openRead(repository_.packs_[pack].path);
+        }
+
+        std::string buffer(packReadSize, '\0');
+        auto readBlock = [&]
+            {
+                input->read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                return std::string_view{ buffer.data(), static_cast<std::size_t>(input->gcount()) };
+            };
+
+        input->clear();
+        input->seekg(static_cast<std::streamoff>(offset));
+        std::string_view block = readBlock();
+
+        // Type and size: 3 bits and 4 bits, then 7 bits per continuation byte.
+        std::size_t position = 0;
+        auto next = [&]
+            {
+                if (position >= block.size()) {
+                    throw corrupt("truncated pack entry"sv);
+                }
+
+                return static_cast<std::uint8_t>(block[position++]);
+            };
+
+        auto byte = next();
+        auto const type = (byte >> 4) & 7;
+        std::uint64_t size = byte & 0x0F;
+        for (int shift = 4; (byte & 0x80) != 0 && shift < 64; shift += 7) {
+            byte = next();
+            size |= std::uint64_t{byte & 0x7Fu} << shift;
+        }
+
+        std::optional<GitObject> base;
+        if (type == packOffsetDelta) {
+            auto const distance = offsetNumber(block, position);
+            if (distance == 0 || distance > offset) {
+                throw corrupt("delta base offset"sv);
+            }
+
+            auto const baseOffset = offset - distance;
+            base = readPacked(pack, baseOffset, depth + 1);
+            if (basesSize_ + base->data.size() > baseCacheSize) {
+                bases_.clear();
+                basesSize_ = 0;
+            }
+
+            basesSize_ += base->data.size();
+            bases_.insert({ { pack, baseOffset }, *base });
+        } else if (type == packReferenceDelta) {
+            auto const baseId = idAt(block, position);
+            position += baseId.size();
+            base = read(baseId);
+        } else if (type < static_cast<int>(GitObjectType::Commit) || type > static_cast<int>(GitObjectType::Tag)) {
+            throw corrupt("pack entry type"sv);
+        }
+
+        // The reads for the base reused the stream: continue after the header.
+        input->clear();
+        input->seekg(static_cast<std::streamoff>(offset + position));
+        auto data = inflateZlib(readBlock, static_cast<std::size_t>(size));
+
+        if (base) {
+            return { base->type, applyDelta(base->data, data) };
+        }
+
+        return { static_cast<GitObjectType>(type), std::move(data) };
+    }
+
+
+    auto convertGitBlobs(
+            GitRepository&              repository,
+            std::span<GitBlob const>    blobs,
+            std::span<TarRule const>    rules,
+            bool                        write,
+            Report*                     report,
+            unsigned                    threads,
+            Stats*                      stats
+        ) -> std::size_t
+    {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        struct Result
+        {
+            bool            matched = false;
+            bool            changed = false;
+            std::size_t     inputSize  = 0;
+            std::size_t     outputSize = 0;
+            GitObjectId     id {};
+            std::string     hash;
+            std::string     error;
+        };
+
+        bool const hashing = report != nullptr && report->outputHash() == OutputHash::Blake3;
+        std::vector<Result> results(blobs.size());
+
+        // Workers take the blobs one by one, each reading through its own reader
+        // and recording into its own stats.
+        std::atomic<std::size_t> next = 0;
+        auto const worker = [&](Stats* local)
+            {
+                GitRepository::Reader reader{repository};
+                for (auto i = next++; i < blobs.size(); i = next++) {
+                    auto const& blob = blobs[i];
+                    auto const rule  = std::ranges::find_if(rules, [&blob](TarRule const& r) { return matchesTarMember(r, blob.path); });
+                    if (rule == rules.end()) {
+                        continue;
+                    }
+
+                    auto& result = results[i];
+                    result.matched = true;
+                    auto const start = std::chrono::steady_clock::now();
+                    try {
+                        auto config = rule->config;
+                        if (config.tabProtection == TabProtection::Auto) {
+                            config.tabProtection = detectTabProtection(fromUtf8(blob.path));
+                        }
+
+                        auto const input = timed(local, Phase::Read, [&] { return reader.read(blob.id); });
+                        if (input.type != GitObjectType::Blob) {
+                            throw corrupt("not a blob"sv);
+                        }
+
+                        auto const output = timed(local, Phase::Convert, [&] { return tabsToSpaces(std::string_view{input.data}, config); });
+                        result.inputSize  = input.data.size();
+                        result.outputSize = output.size();
+                        result.changed    = output != input.data;
+                        result.id         = blob.id;
+                        if (result.changed && write) {
+                            result.id = timed(local, Phase::Write, [&] { return repository.writeObject(GitObjectType::Blob, output); });
+                        }
+
+                        if (hashing) {
+                            Blake3 hash;
+                            hash.update(output);
+                            result.hash = Blake3::toHex(hash.digest());
+                        }
+                    } catch (std::exception const& e) {
+                        result.error = blob.path + ": "s + e.what();
+                    }
+
+                    if (local != nullptr) {
+                        auto const elapsed = std::chrono::steady_clock::now() - start;
+                        local->addFile({ fromUtf8(blob.path), result.inputSize,
+                            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) });
+                    }
+                }
+            };
+
+        {
+            auto const workers = std::max<std::size_t>(1, std::min<std::size_t>(threads, blobs.size()));
+            std::vector<std::unique_ptr<Stats>> locals(stats != nullptr ? workers : 0);
+            for (auto& local : locals) {
+                local = std::make_unique<Stats>(stats->topCount());
+            }
+
+            auto const localOf = [&locals](std::size_t index)
+                {
+                    return locals.empty() ? nullptr : locals[index].get();
+                };
+
+            {
+                std::vector<std::jthread> helpers;
+                while (helpers.size() + 1 < workers) {
+                    helpers.emplace_back(worker, localOf(helpers.size() + 1));
+                }
+
+                worker(localOf(0));
+            }
+
+            for (auto const& local : locals) {
+                stats->merge(*local);
+            }
+        }
+
+        std::size_t changedCount = 0;
+        std::vector<GitBlob> changedEntries;
+        for (std::size_t i = 0; i < blobs.size(); ++i) {
+            auto& result = results[i];
+            if (!result.error.empty()) {
+                throw std::runtime_error(result.error);
+            }
+
+            if (!result.matched) {
+                continue;
+            }
+
+            if (result.changed) {
+                ++changedCount;
+                if (blobs[i].indexEntry != 0) {
+                    changedEntries.push_back({ blobs[i].path, result.id, blobs[i].indexEntry });
+                }
+            }
+
+            if (report != nullptr) {
+                FileResult file;
+                file.path       = fromUtf8(blobs[i].path);
+                file.outcome    = result.changed ? FileOutcome::Converted : FileOutcome::Unchanged;
+                file.inputSize  = result.inputSize;
+                file.outputSize = result.outputSize;
+                file.hash       = std::move(result.hash);
+                report->add(std::move(file));
+            }
+        }
+
+        if (write) {
+            timed(stats, Phase::Write, [&] { repository.writeIndex(changedEntries); });
+        }
+
+        return changedCount;
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_git()
+    {
+        int errors = 0;
+        auto check = [&errors](bool ok, std::string_view what)
+            {
+                if (!ok) {
+                    std::clog << "Test failed: git "sv << what << '\n';
+                    ++errors;
+                }
+            };
+
+        {
+            Sha1 hash;
+            hash.update("abc"sv);
+            check(toHex(hash.digest()) == "a9993e364706816aba3e25717850c26c9cd0d89d"sv, "SHA-1");
+        }
+
+        check(applyDelta("hello world"sv, "\x0B\x0E\x90\x05\x04" "abc!" "\x91\x06\x05"sv) == "helloabc!world"sv, "delta");
+
+    #ifdef  TABS_TO_SPACES_GZIP
+        try {
+            auto name = [](GitObjectId const& id)
+                {
+                    return std::string{ reinterpret_cast<char const*>(id.data()), id.size() };
+                };
+
+            auto treeEntry = [&name](std::string_view mode, std::string_view path, GitObjectId const& id)
+                {
+                    return std::string{mode} + ' ' + std::string{path} + '\0' + name(id);
+                };
+
+            auto bigEndian32 = [](std::uint32_t value)
+                {
+                    return std::string{ static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                                        static_cast<char>(value >> 8), static_cast<char>(value) };
+                };
+
+            // Loose objects and references.
+            MemoryFileSystem files;
+            files.addFile(".git/HEAD", "ref: refs/heads/main\n");
+            files.createDirectories(".git/objects/pack");
+            GitRepository repository(".git", &files);
+
+            auto const a    = repository.writeObject(GitObjectType::Blob, "\ta\n"sv);
+            auto const b    = repository.writeObject(GitObjectType::Blob, "b\n"sv);
+            auto const sub  = repository.writeObject(GitObjectType::Tree, treeEntry("100644", "b.c", b));
+            auto const tree = repository.writeObject(GitObjectType::Tree, treeEntry("100644", "a.c", a) + treeEntry("40000", "src", sub));
+            auto const head = repository.writeObject(GitObjectType::Commit, "tree "s + toHex(tree) + "\n\nmessage\n"s);
+            files.addFile(".git/packed-refs", "# pack-refs with: peeled\n"s + toHex(head) + " refs/heads/main\n"s);
+
+            check(toHex(a) == "a16aba443b08ea34aba18ece27f6d59ea49655ce"sv, "object name");
+
+            auto const blobs = repository.treeBlobs(repository.resolve("HEAD"));
+            check(blobs.size() == 2 && blobs[0].path == "a.c" && blobs[0].id == a
+               && blobs[1].path == "src/b.c" && blobs[1].id == b
+               && repository.resolve("main") == head, "tree");
+
+            Report report;
+            Config config;
+            config.directoryWalk = DirectoryWalk::Nested;
+            TarRule const rules[] { { "*.c", config } };
+            check(convertGitBlobs(repository, blobs, rules, false, &report, 1) == 1
+               && report.files().size() == 2
+               && report.files()[0].outcome == FileOutcome::Converted, "check");
+
+            // An index (version 2) with a cached tree, updated with the converted blob.
+            std::string index = "DIRC"s + bigEndian32(2) + bigEndian32(2);
+            for (auto const& blob : blobs) {
+                auto entry = std::string(24, '\0') + bigEndian32(0100644) + std::string(8, '\0') + bigEndian32(3)
+                           + name(blob.id) + std::string{ '\0', static_cast<char>(blob.path.size()) } + blob.path;
+                entry.resize((entry.size() + 8) & ~std::size_t{7}, '\0');
+                index += entry;
+            }
+
+            index += "TREE"s + bigEndian32(4) + "tree"s + "UNTR"s + bigEndian32(2) + "ok"s + "FSMN"s + bigEndian32(5) + "token"s;
+            Sha1 indexHash;
+            indexHash.update(index);
+            files.addFile(".git/index", index + name(indexHash.digest()));
+
+            auto const indexBlobs = repository.readIndex();
+            check(indexBlobs.size() == 2 && indexBlobs[1].path == "src/b.c" && indexBlobs[1].id == b, "index");
+
+            // A lock held by git (or an index changed since it was read) stops the write.
+            auto refused = [&]
+                {
+                    try {
+                        [[maybe_unused]] auto const changed = convertGitBlobs(repository, indexBlobs, rules, true, nullptr, 1);
+                    } catch (std::exception const&) {
+                        return true;
+                    }
+
+                    return false;
+                };
+
+            files.addFile(".git/index.lock", "");
+            check(refused() && files.file(".git/index.lock") != nullptr && *files.file(".git/index") == index + name(indexHash.digest()),
+                "write with the index locked");
+            files.remove(".git/index.lock");
+
+            files.addFile(".git/index", index + name(indexHash.digest()) + "!");
+            check(refused() && files.file(".git/index.lock") == nullptr, "write of an index changed");
+            files.addFile(".git/index", index + name(indexHash.digest()));
+
+            check(convertGitBlobs(repository, indexBlobs, rules, true, nullptr, 1) == 1
+               && files.file(".git/index.lock") == nullptr, "write");
+            auto const written = *files.file(".git/index");
+            Sha1 writtenHash;
+            writtenHash.update(std::string_view{written}.substr(0, written.size() - 20));
+
+            GitRepository reread(".git", &files);
+            auto const updated = reread.readIndex();
+            check(updated.size() == 2
+               && reread.readObject(updated[0].id).data == "    a\n"
+               && updated[1].id == b
+               && written.find("TREE"sv) == written.npos
+               && written.find("UNTR"sv) != written.npos
+               && written.find("FSMN"sv) == written.npos
+               && written.ends_with(name(writtenHash.digest())), "index update");
+
+            // A pack with a blob and a delta of it.
+            std::string const base    = "\tline one\n\tline two\n";
+            std::string const derived = "\tline one\n\tline 2\n";
+            std::string const delta   = "\x14\x12\x90\x0A\x08"s + "\tline 2\n"s;
+
+            std::string pack = "PACK"s + bigEndian32(2) + bigEndian32(2);
+            std::uint32_t const baseOffset = static_cast<std::uint32_t>(pack.size());
+            pack += "\xB4\x01"s + deflateZlib(base);
+            std::uint32_t const deltaOffset = static_cast<std::uint32_t>(pack.size());
+            pack += static_cast<char>(0x60 | delta.size()) + std::string(1, static_cast<char>(deltaOffset - baseOffset)) + deflateZlib(delta);
+
+            auto objectName = [](std::string_view content)
+                {
+                    Sha1 hash;
+                    hash.update(objectHeader(GitObjectType::Blob, content.size()));
+                    hash.update(content);
+                    return hash.digest();
+                };
+
+            std::pair<GitObjectId, std::uint32_t> entries[] { { objectName(base), baseOffset }, { objectName(derived), deltaOffset } };
+            std::ranges::sort(entries);
+
+            std::string idx = "\xFFtOc"s + bigEndian32(2);
+            for (int byte = 0; byte < 256; ++byte) {
+                idx += bigEndian32(static_cast<std::uint32_t>(std::ranges::count_if(entries, [byte](auto const& e) { return e.first[0] <= byte; })));
+            }
+
+            for (auto const& entry : entries) {
+                idx += name(entry.first);
+            }
+
+            idx += std::string(8, '\0');
+            for (auto const& entry : entries) {
+                idx += bigEndian32(entry.second);
+            }
+
+            idx += std::string(40, '\0');
+            files.addFile(".git/objects/pack/pack-1.pack", pack);
+            files.addFile(".git/objects/pack/pack-1.idx", idx);
+
+            GitRepository packed(".git", &files);
+            GitBlob const packedBlobs[] { { "p.c", objectName(derived), 0 } };
+            Report packedReport;
+            check(packed.readObject(objectName(base)).data == base
+               && packed.readObject(objectName(derived)).data == derived
+               && convertGitBlobs(packed, packedBlobs, rules, false, &packedReport, 1) == 1
+               && packedReport.files()[0].outputSize == derived.size() + 6, "pack");
+        } catch (std::exception const& e) {
+            std::clog << "Test failed: git: "sv << e.what() << '\n';
+            ++errors;
+        }
+    #endif//TABS_TO_SPACES_GZIP
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
@@ -0,0 +1,182 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_GIT_HPP
+#define TABS_TO_SPACES_GIT_HPP
+
+#include "tabs_to_spaces.hpp"
+#include "tabs_to_spaces_tar.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <map>
+#include <optional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <istream>
+#include <filesystem>
+#include <cstdint>
+
+namespace TabsToSpaces
+{
+
+    class FileSystem;
+    class Stats;
+
+    // SHA-1 object name.
+    using GitObjectId = std::array<std::uint8_t, 20>;
+
+    [[nodiscard]] auto toHex(GitObjectId const& id)
+        -> std::string;
+
+    enum class GitObjectType
+    {
+        Commit  = 1,
+        Tree    = 2,
+        Blob    = 3,
+        Tag     = 4,
+    };
+
+    struct GitObject
+    {
+        GitObjectType   type = GitObjectType::Blob;
+        std::string     data;
+    };
+
+    // A regular file of a tree or of the index.
+    struct GitBlob
+    {
+        std::string     path;               // with / separators
+        GitObjectId     id {};
+        std::size_t     indexEntry = 0;     // offset of the index entry, 0 for blobs of trees
+    };
+
+    // The git directory of the repository containing the directory: $GIT_DIR if set,
+    // otherwise .git of the directory or of its nearest parent having it
+    // (a .git file of a linked worktree or submodule points to the directory).
+    [[nodiscard]] auto findGitDirectory(std::filesystem::path const& directory)
+        -> std::filesystem::path;
+
+    // Objects (loose and packed), references and the index of a repository read without
+    // a checkout. Pack indexes (version 2) are loaded once; objects are read through readers,
+    // one per thread. Only SHA-1 repositories are supported.
+    class GitRepository
+    {
+    public:
+        class Reader;
+
+        // Read from the native file system if fileSystem is null.
+        explicit GitRepository(
+                std::filesystem::path   gitDirectory,
+                FileSystem*             fileSystem = nullptr
+            );
+
+        // A full hex object name, HEAD or a reference (a branch, a tag, refs/...).
+        [[nodiscard]] auto resolve(std::string_view revision) const
+            -> GitObjectId;
+
+        [[nodiscard]] auto readObject(GitObjectId const& id) const
+            -> GitObject;
+
+        // The regular files of the tree of the commit (tags are peeled), sorted by path.
+        [[nodiscard]] auto treeBlobs(GitObjectId const& id) const
+            -> std::vector<GitBlob>;
+
+        // The regular files of stage 0 of the index (versions 2 to 4), kept for writeIndex.
+        [[nodiscard]] auto readIndex()
+            -> std::vector<GitBlob>;
+
+        // Store the object as a loose object unless it exists. Safe to call from several threads.
+        auto writeObject(
+                GitObjectType       type,
+                std::string_view    data
+            ) -> GitObjectId;
+
+        // Point the index entries of the blobs (from readIndex) to their ids and write the index.
+        // The size recorded for them is cleared, so git compares the working tree files again,
+        // and the cached tree extension is dropped.
+        void writeIndex(std::span<GitBlob const> changed);
+
+    private:
+        friend class Reader;
+
+        struct Pack
+        {
+            std::filesystem::path   path;
+            std::string             index;      // the .idx file
+            std::uint32_t           count = 0;
+        };
+
+        struct PackLocation
+        {
+            std::size_t     pack;
+            std::uint64_t   offset;
+        };
+
+        [[nodiscard]] auto findPacked(GitObjectId const& id) const noexcept
+            -> std::optional<PackLocation>;
+
+        [[nodiscard]] auto looseObjectPath(GitObjectId const& id) const
+            -> std::filesystem::path;
+
+        [[nodiscard]] auto readReference(
+                std::string const&  name,
+                int                 depth
+            ) const -> std::optional<GitObjectId>;
+
+        FileSystem&             fileSystem_;
+        std::filesystem::path   gitDirectory_;      // HEAD and the index
+        std::filesystem::path   commonDirectory_;   // objects and references
+        std::vector<Pack>       packs_;
+        std::string             index_;
+        std::size_t             indexEntriesEnd_ = 0;
+        std::mutex              writeMutex_;
+    };
+
+    // Reads objects keeping the pack files open and recent delta bases.
+    class GitRepository::Reader
+    {
+    public:
+        explicit Reader(GitRepository const& repository) noexcept;
+
+        [[nodiscard]] auto read(GitObjectId const& id)
+            -> GitObject;
+
+    private:
+        [[nodiscard]] auto readPacked(
+                std::size_t     pack,
+                std::uint64_t   offset,
+                int             depth
+            ) -> GitObject;
+
+        GitRepository const&                                            repository_;
+        std::vector<std::unique_ptr<std::istream>>                      packs_;
+        std::map<std::pair<std::size_t, std::uint64_t>, GitObject>     bases_;
+        std::size_t                                                     basesSize_ = 0;
+    };
+
+    // Convert the blobs matching a rule (the first matching rule applies) on threads (as many
+    // as the hardware runs if 0). If write, the converted blobs are stored as loose objects and
+    // the index entries of index blobs are updated. Returns the number of blobs the conversion
+    // changes; they are added to the report as converted, the others as unchanged.
+    // If stats is not null, the latencies of reading, converting and writing are recorded there.
+    auto convertGitBlobs(
+            GitRepository&              repository,
+            std::span<GitBlob const>    blobs,
+            std::span<TarRule const>    rules,
+            bool                        write,
+            Report*                     report  = nullptr,
+            unsigned                    threads = 0,
+            Stats*                      stats   = nullptr
+        ) -> std::size_t;
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_git();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_GIT_HPP
@@ -2,9 +2,29 @@
 // This file is part of TabsToSpaces utility
 // See LICENSE file for license and warranty information.
 #include "tabs_to_spaces.hpp"
+#include "tabs_to_spaces_tar.hpp"
+#include "tabs_to_spaces_audit.hpp"
+#include "tabs_to_spaces_transaction.hpp"
+#include "tabs_to_spaces_file_system.hpp"
+#include "tabs_to_spaces_git.hpp"
+#include "tabs_to_spaces_stats.hpp"
+#include "tabs_to_spaces_metrics.hpp"
+#include "tabs_to_spaces_buffer.hpp"
 #include <iomanip>
+#include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <utility>
+#include <vector>
+#include <optional>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 int main(int argc, char* argv[])
 {
@@ -22,6 +42,9 @@ int main(int argc, char* argv[])
     using namespace std::literals;
     using namespace TabsToSpaces;
 
+    auto const startTime  = std::chrono::system_clock::now();
+    auto const startClock = std::chrono::steady_clock::now();
+
     constexpr std::string_view helpParam = "--help"sv;
     constexpr std::string_view widthParam[]
     {
@@ -31,28 +54,164 @@ int main(int argc, char* argv[])
 
     constexpr std::string_view lfParam     = "--lf"sv;
     constexpr std::string_view crlfParam   = "--crlf"sv;
+    constexpr std::string_view autoLfParam = "--lf-or-crlf=auto"sv;
     constexpr std::string_view trimParam   = "--trim"sv;
     constexpr std::string_view noTrimParam = "--notrim"sv;
     constexpr std::string_view recParam    = "--rec"sv;
     constexpr std::string_view noRecParam  = "--norec"sv;
 
+    constexpr std::string_view stripBomParam    = "--stripbom"sv;
+    constexpr std::string_view keepBomParam     = "--keepbom"sv;
+    constexpr std::string_view finalNlParam     = "--finalnl"sv;
+    constexpr std::string_view noFinalNlParam   = "--nofinalnl"sv;
+    constexpr std::string_view trimEofParam     = "--trimeof"sv;
+    constexpr std::string_view noTrimEofParam   = "--notrimeof"sv;
+
+    constexpr std::string_view reindentParam      = "--reindent="sv;
+    constexpr std::string_view noReindentParam    = "--noreindent"sv;
+
+    constexpr std::string_view toTabsParam        = "--totabs"sv;
+    constexpr std::string_view toLeadingTabsParam = "--totabs=leading"sv;
+    constexpr std::string_view toSpacesParam      = "--tospaces"sv;
+
+    constexpr std::string_view hashParam    = "--hash"sv;
+    constexpr std::string_view noHashParam  = "--nohash"sv;
+    constexpr std::string_view reportParam  = "--report="sv;
+    constexpr std::string_view outDirParam  = "--out-dir="sv;
+
+    constexpr std::string_view compressedParam   = "--compressed"sv;
+    constexpr std::string_view noCompressedParam = "--nocompressed"sv;
+    constexpr std::string_view tarParam          = "--tar="sv;
+    constexpr std::string_view diffParam         = "--diff"sv;
+    constexpr std::string_view noDiffParam       = "--nodiff"sv;
+    constexpr std::string_view auditParam        = "--audit"sv;
+    constexpr std::string_view markersParam      = "--markers"sv;
+    constexpr std::string_view noMarkersParam    = "--nomarkers"sv;
+    constexpr std::string_view transactionParam  = "--transaction="sv;
+    constexpr std::string_view commitParam       = "--commit="sv;
+    constexpr std::string_view rollbackParam     = "--rollback="sv;
+    constexpr std::string_view gitParam          = "--git="sv;
+    constexpr std::string_view gitIndexParam     = "--git-index"sv;
+    constexpr std::string_view gitWriteParam     = "--git-write"sv;
+    constexpr std::string_view statsParam        = "--stats"sv;
+    constexpr std::string_view noStatsParam      = "--nostats"sv;
+    constexpr std::string_view metricsFileParam  = "--metrics-file="sv;
+    constexpr std::string_view prefaultParam     = "--prefault"sv;
+    constexpr std::string_view noPrefaultParam   = "--noprefault"sv;
+
+    constexpr std::string_view noProtectParam = "--noprotect"sv;
+    constexpr std::string_view protectParam   = "--protect"sv;
+    constexpr std::pair<std::string_view, TabProtection> protectModes[]
+    {
+        { "--protect=make"sv, TabProtection::Makefile },
+        { "--protect=tsv"sv,  TabProtection::Tsv      },
+        { "--protect=c"sv,    TabProtection::CLike    },
+    };
+
     if (argc == 1 || std::ranges::contains(argv + 1, argv + argc, helpParam)) {
         std::cout <<
 "TabsToSpaces v.1.1b converts files passed as command line parameters by sub-\n"
 "stituting each tab with spaces until the next column is reached.\n"
 "Column (tab) width is 4 spaces by default but may be selected by using params\n"
-"-w:width or --width=width.\n\n"
+"-w:width or --width=width.\n"
+"Width may also be a list of tab stops like in expand -t: 4,8,20 (a tab past\n"
+"the last stop becomes a single space), 4,8,+8 (then every 8 columns) or\n"
+"4,8,/8 (then at multiples of 8). Width auto detects the tab width of each file\n"
+"by its indentation.\n\n"
 "Another parameters:\n"
+"* --totabs converts the other way: blanks reaching a tab stop become tabs\n"
+"(like unexpand -a), --totabs=leading does it only for the blanks beginning\n"
+"lines (like unexpand), --tospaces converts tabs to spaces (default option).\n"
+"* --reindent=to rescales leading indentation to to columns per level, the\n"
+"level width of each file being detected; --reindent=from:to gives it\n"
+"explicitly; --noreindent keeps indentation (default option).\n"
 "* --crlf enables conversion of single LF (without preceding CR) into\n"
 "CR LF sequences.\n"
 "* --lf enables conversion of CR LF to single LFs.\n"
+"* --lf-or-crlf=auto converts new-lines of each file to its dominant kind.\n"
 "* --rec enables recursive (nested) directory walk (with subdirectories).\n"
 "* --norec disables recursive directory walk (default option).\n"
 "* --trim enables deleting all whitespaces before newlines.\n"
-"* --notrim disables whitespace trimming (default option).\n"sv;
+"* --notrim disables whitespace trimming (default option).\n"
+"* --protect leaves intact tabs which are significant for the file type chosen\n"
+"by file name: Makefile recipe lines, all tabs in TSV files, string and\n"
+"character literals in C-like languages.\n"
+"* --protect=make, --protect=tsv, --protect=c use the given file type for all\n"
+"files.\n"
+"* --noprotect disables tab protection (default option).\n"
+"* --stripbom deletes UTF-8 byte order mark, --keepbom keeps it (default).\n"
+"* --finalnl ends each non-empty file with a new-line, --nofinalnl disables it\n"
+"(default option).\n"
+"* --trimeof deletes blank lines at the end of file, --notrimeof disables it\n"
+"(default option).\n"
+"All the enabled transforms are done in one pass over the file.\n"
+"* --report=path writes a JSON report on the processed files.\n"
+"* --hash adds BLAKE3 hash of each output file to the report, computed while the\n"
+"file is written, --nohash disables it (default option).\n"
+"* --out-dir=dir leaves the files intact and writes the results into dir\n"
+"mirroring the input tree (paths relative to the current directory).\n"
+"Unchanged files are cloned where the file system supports it.\n"
+"--out-dir= (empty) returns to in-place conversion (default option).\n"
+"* --compressed converts gzip and zstd files (detected by contents) streaming\n"
+"them through decompression and compression back to the same format,\n"
+"--nocompressed processes them as any other file (default option).\n"
+"* --tar=archive reads a tar archive (- for stdin) and writes it to stdout with\n"
+"the matching member files converted, never unpacking it to disk. The file\n"
+"names following it are patterns of the members (e.g. src/*.c with --rec),\n"
+"each converted with the parameters preceding its pattern; without patterns\n"
+"all the members are converted.\n"
+"* --diff leaves the files intact and prints unified diffs of the changes to\n"
+"stdout, --nodiff converts the files (default option).\n"
+"* --markers skips the files marked clean for the current parameters by an\n"
+"extended attribute (user.tabs2spaces) without reading them and marks the\n"
+"results, --nomarkers disables it (default option).\n"
+"* --transaction=dir hard links each file into dir before it is replaced (and\n"
+"notes the files created) so the run can be undone; dir must not hold another\n"
+"transaction and must be on the same file system for links, otherwise the\n"
+"files are copied.\n"
+"--transaction= (empty) ends it. --commit=dir keeps the results deleting the\n"
+"snapshot, --rollback=dir puts the original files back in parallel.\n"
+"* --git=revision checks the files of a commit (e.g. HEAD, a branch or a tag)\n"
+"reading them from the git repository of the current directory without a\n"
+"checkout, --git-index checks the staged files instead. The file names\n"
+"following it are path patterns (all files if none are given), the files the\n"
+"conversion would change are reported as converted and make the exit code\n"
+"non-zero. --git-write with --git-index stores the converted files as new\n"
+"objects and updates the index.\n"
+"* --stats times the stat, read, convert and write of each file following it\n"
+"and prints the 50th, 90th and 99th percentiles and the maximum of each phase\n"
+"and the slowest and the largest files to stderr at the end, --nostats stops\n"
+"printing and timing, timing goes on for --metrics-file (default option).\n"
+"* --metrics-file=path writes counters of the files and bytes by outcome and of\n"
+"the errors, the duration and throughput of the run and histograms of the\n"
+"phase latencies in the OpenMetrics text format to path at exit (written to a\n"
+"temporary file renamed over path). It times the files like --stats without\n"
+"printing.\n"
+"* --prefault faults in the huge pages of the buffers for large diffed files\n"
+"when they are allocated, --noprefault faults them in as they are written\n"
+"(default option).\n"
+"* --audit scans the files following it in parallel without converting them\n"
+"and prints a JSON report of their whitespace: tabs (indentation and\n"
+"alignment), CRLF, LF and lone CR line endings, trailing whitespace bytes and\n"
+"mixed indentation lines per file and rolled up per directory.\n"sv;
     }
 
     Config config;
+    Report report;
+    LargeBufferPool largeBuffers;
+    FileOptions fileOptions;
+    fileOptions.largeBuffers = &largeBuffers;
+    std::filesystem::path reportPath;
+    std::optional<std::string> tarArchive;
+    std::vector<TarRule> tarRules;
+    std::optional<Audit> audit;
+    std::optional<Transaction> transaction;
+    std::optional<Stats> stats;
+    bool printStats = false;
+    std::filesystem::path metricsPath;
+    std::optional<std::string> gitRevision;   // empty for the index
+    std::vector<TarRule> gitRules;
+    bool gitWrite = false;
     int errors = 0;
 
     for (int i = 1; i < argc; ++i) {
@@ -70,6 +229,8 @@ int main(int argc, char* argv[])
                 config.lineEndingMode = LineEndingMode::Lf;
             } else if (arg == crlfParam) {
                 config.lineEndingMode = LineEndingMode::CrLf;
+            } else if (arg == autoLfParam) {
+                config.lineEndingMode = LineEndingMode::Auto;
             } else if (arg == trimParam) {
                 config.whitespaceBeforeNewLines = WhitespaceBeforeNewLines::Trim;
             } else if (arg == noTrimParam) {
@@ -78,12 +239,106 @@ int main(int argc, char* argv[])
                 config.directoryWalk = DirectoryWalk::Nested;
             } else if (arg == noRecParam) {
                 config.directoryWalk = DirectoryWalk::OneLevel;
+            } else if (arg == stripBomParam) {
+                config.byteOrderMark = ByteOrderMark::Strip;
+            } else if (arg == keepBomParam) {
+                config.byteOrderMark = ByteOrderMark::Keep;
+            } else if (arg == finalNlParam) {
+                config.finalNewline = FinalNewline::Ensure;
+            } else if (arg == noFinalNlParam) {
+                config.finalNewline = FinalNewline::Keep;
+            } else if (arg == trimEofParam) {
+                config.trailingBlankLines = TrailingBlankLines::Delete;
+            } else if (arg == noTrimEofParam) {
+                config.trailingBlankLines = TrailingBlankLines::Keep;
+            } else if (arg.starts_with(reindentParam)) {
+                config = parseReindent(arg.substr(reindentParam.size()), config);
+            } else if (arg == noReindentParam) {
+                config.targetIndent = 0;
+            } else if (arg == toTabsParam) {
+                config.conversion = Conversion::SpacesToTabs;
+            } else if (arg == toLeadingTabsParam) {
+                config.conversion = Conversion::LeadingSpacesToTabs;
+            } else if (arg == toSpacesParam) {
+                config.conversion = Conversion::TabsToSpaces;
+            } else if (arg == hashParam) {
+                report.setOutputHash(OutputHash::Blake3);
+            } else if (arg == noHashParam) {
+                report.setOutputHash(OutputHash::None);
+            } else if (arg == compressedParam) {
+                fileOptions.compressedFiles = CompressedFiles::Stream;
+            } else if (arg == noCompressedParam) {
+                fileOptions.compressedFiles = CompressedFiles::AsIs;
+            } else if (arg.starts_with(outDirParam)) {
+                fileOptions.outputDirectory = std::filesystem::path{arg.substr(outDirParam.size())};
+            } else if (arg == diffParam) {
+                fileOptions.diff = &std::cout;
+            #ifdef _WIN32
+                _setmode(_fileno(stdout), _O_BINARY);   // the diffs keep the line endings of the files
+            #endif
+            } else if (arg == noDiffParam) {
+                fileOptions.diff = nullptr;
+            } else if (arg == markersParam) {
+                fileOptions.cleanMarkers = CleanMarkers::Use;
+            } else if (arg == noMarkersParam) {
+                fileOptions.cleanMarkers = CleanMarkers::Ignore;
+            } else if (arg.starts_with(transactionParam)) {
+                fileOptions.transaction = nullptr;
+                transaction.reset();
+                if (auto const directory = arg.substr(transactionParam.size()); !directory.empty()) {
+                    auto& files = fileOptions.fileSystem != nullptr ? *fileOptions.fileSystem : nativeFileSystem();
+                    fileOptions.transaction = &transaction.emplace(files, std::filesystem::path{directory});
+                }
+            } else if (arg.starts_with(commitParam)) {
+                commitTransaction(nativeFileSystem(), std::filesystem::path{arg.substr(commitParam.size())});
+            } else if (arg.starts_with(rollbackParam)) {
+                rollbackTransaction(nativeFileSystem(), std::filesystem::path{arg.substr(rollbackParam.size())});
+            } else if (arg.starts_with(gitParam)) {
+                gitRevision = std::string{arg.substr(gitParam.size())};
+            } else if (arg == gitIndexParam) {
+                gitRevision = std::string{};
+            } else if (arg == gitWriteParam) {
+                gitWrite = true;
+            } else if (arg == statsParam) {
+                printStats = true;
+                fileOptions.stats = stats ? &*stats : &stats.emplace();
+            } else if (arg == noStatsParam) {
+                printStats = false;
+                if (metricsPath.empty()) {
+                    fileOptions.stats = nullptr;     // the metrics file keeps the timing
+                }
+            } else if (arg == prefaultParam) {
+                largeBuffers.setPrefault(Prefault::Yes);
+            } else if (arg == noPrefaultParam) {
+                largeBuffers.setPrefault(Prefault::No);
+            } else if (arg.starts_with(metricsFileParam)) {
+                metricsPath = std::filesystem::path{arg.substr(metricsFileParam.size())};
+                fileOptions.stats = stats ? &*stats : &stats.emplace();
+            } else if (arg == auditParam) {
+                audit.emplace(fileOptions.fileSystem);
+            } else if (arg.starts_with(tarParam)) {
+                tarArchive = std::string{arg.substr(tarParam.size())};
+            } else if (arg.starts_with(reportParam)) {
+                reportPath = std::filesystem::path{arg.substr(reportParam.size())};
+            } else if (arg == protectParam) {
+                config.tabProtection = TabProtection::Auto;
+            } else if (arg == noProtectParam) {
+                config.tabProtection = TabProtection::None;
+            } else if (auto mode = std::ranges::find(protectModes, arg, &std::pair<std::string_view, TabProtection>::first);
+                       mode != std::ranges::end(protectModes)) {
+                config.tabProtection = mode->second;
             } else if (arg.starts_with(widthParam[0])) {
-                config.tabWidth = std::stoi( std::string{arg.substr(widthParam[0].size())} );
+                config = parseTabWidth(arg.substr(widthParam[0].size()), config);
             } else if (arg.starts_with(widthParam[1])) {
-                config.tabWidth = std::stoi( std::string{arg.substr(widthParam[1].size())} ); 
+                config = parseTabWidth(arg.substr(widthParam[1].size()), config);
+            } else if (audit) {
+                audit->add(std::filesystem::path{argv[i]}, config.directoryWalk);
+            } else if (tarArchive) {
+                tarRules.push_back({ std::string{arg}, config });
+            } else if (gitRevision) {
+                gitRules.push_back({ std::string{arg}, config });
             } else {
-                tabsToSpaces(std::filesystem::path{argv[i]}, config);
+                tabsToSpaces(std::filesystem::path{argv[i]}, config, report, fileOptions);
             }
         } catch (std::filesystem::filesystem_error const& e) {
             errorPrologue();
@@ -109,5 +364,99 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (tarArchive) {
+        if (tarRules.empty()) {
+            config.directoryWalk = DirectoryWalk::Nested;
+            tarRules.push_back({ "*", config });
+        }
+
+    #ifdef _WIN32
+        _setmode(_fileno(stdin),  _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+    #endif
+
+        try {
+            if (*tarArchive == "-"sv) {
+                convertTar(std::cin, std::cout, tarRules, &report);
+            } else {
+                std::ifstream file(std::filesystem::path{*tarArchive}, std::ios::binary);
+                if (!file.is_open()) {
+                    throw std::runtime_error("Archive read failed: "s + *tarArchive);
+                }
+
+                convertTar(file, std::cout, tarRules, &report);
+            }
+        } catch (std::exception const& e) {
+            ++errors;
+            std::clog << "On archive "sv << std::quoted(*tarArchive) << " error: "sv << e.what() << std::endl;
+        }
+    }
+
+    if (gitRevision) {
+        if (gitRules.empty()) {
+            config.directoryWalk = DirectoryWalk::Nested;
+            gitRules.push_back({ "*", config });
+        }
+
+        try {
+            if (gitWrite && !gitRevision->empty()) {
+                throw std::invalid_argument("--git-write needs --git-index");
+            }
+
+            GitRepository repository(findGitDirectory(std::filesystem::current_path()), fileOptions.fileSystem);
+            auto const blobs = gitRevision->empty()
+                ? repository.readIndex()
+                : repository.treeBlobs(repository.resolve(*gitRevision));
+
+            if (auto const changed = convertGitBlobs(repository, blobs, gitRules, gitWrite, &report, 0, fileOptions.stats); changed != 0 && !gitWrite) {
+                ++errors;
+                std::clog << changed << " git files need conversion"sv << std::endl;
+            }
+        } catch (std::exception const& e) {
+            ++errors;
+            std::clog << "On git "sv << std::quoted(gitRevision->empty() ? "index"s : *gitRevision) << " error: "sv << e.what() << std::endl;
+        }
+    }
+
+    if (audit) {
+        audit->scan();
+        audit->writeJson(std::cout);
+        for (auto const& file : audit->files()) {
+            if (!file.error.empty()) {
+                ++errors;
+                std::clog << "On file "sv << file.path << " error: "sv << file.error << std::endl;
+            }
+        }
+    }
+
+    if (printStats) {
+        stats->write(std::clog);
+    }
+
+    if (!reportPath.empty()) {
+        std::ofstream file(reportPath, std::ios::binary);
+        report.writeJson(file);
+        if (!file) {
+            ++errors;
+            std::clog << "Report write failed: "sv << reportPath << std::endl;
+        }
+    }
+
+    if (!metricsPath.empty()) {
+        try {
+            RunMetrics run;
+            run.report  = &report;
+            run.stats   = stats ? &*stats : nullptr;
+            run.errors  = static_cast<std::uint64_t>(errors);
+            run.started = std::chrono::duration<double>(startTime.time_since_epoch()).count();
+            run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startClock).count();
+            auto& files = fileOptions.fileSystem != nullptr ? *fileOptions.fileSystem : nativeFileSystem();
+            writeMetricsFile(files, metricsPath, run);
+        } catch (std::exception const& e) {
+            ++errors;
+            std::clog << "Metrics write failed: "sv << metricsPath << ' ' << e.what() << std::endl;
+        }
+    }
+
     return errors;
 }
@@ -0,0 +1,266 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_metrics.hpp"
+#include "tabs_to_spaces.hpp"
+#include "tabs_to_spaces_report.hpp"
+#include "tabs_to_spaces_stats.hpp"
+#include "tabs_to_spaces_file_system.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <sstream>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+    namespace
+    {
+
+        constexpr std::string_view prefix = "tabs2spaces_"sv;
+
+        // Nominal upper bounds of the latency histogram buckets in nanoseconds, 1 µs to 10 s.
+        // Each is published as the limit of the LatencyHistogram bucket holding it (up to 12.5 % higher),
+        // as only there the cumulative count of whole buckets is exact.
+        constexpr std::uint64_t latencyBuckets[] { 1'000, 10'000, 100'000, 1'000'000, 10'000'000,
+                                                   100'000'000, 1'000'000'000, 10'000'000'000 };
+
+        // A floating point value written in the shortest form reading back the same.
+        struct Number
+        {
+            double value;
+        };
+
+        auto operator<<(std::ostream& os, Number number)
+            -> std::ostream&
+        {
+            char buffer[32];
+            auto const end = std::to_chars(std::begin(buffer), std::end(buffer), number.value).ptr;
+            return os.write(buffer, end - buffer);
+        }
+
+        void writeFamily(
+                std::ostream&       os,
+                std::string_view    name,
+                std::string_view    type,
+                std::string_view    unit,
+                std::string_view    help
+            )
+        {
+            os << "# TYPE "sv << prefix << name << ' ' << type << '\n';
+            if (!unit.empty()) {
+                os << "# UNIT "sv << prefix << name << ' ' << unit << '\n';
+            }
+
+            os << "# HELP "sv << prefix << name << ' ' << help << '\n';
+        }
+
+        struct OutcomeTotals
+        {
+            std::uint64_t files  = 0;
+            std::uint64_t input  = 0;
+            std::uint64_t output = 0;
+        };
+
+        using Totals = std::array<OutcomeTotals, fileOutcomeCount>;
+
+        // A counter family with a sample per outcome.
+        void writeOutcomeCounter(
+                std::ostream&                   os,
+                std::string_view                name,
+                std::string_view                unit,
+                std::string_view                help,
+                Totals const&                   totals,
+                std::uint64_t OutcomeTotals::*  value,
+                double                          created
+            )
+        {
+            writeFamily(os, name, "counter"sv, unit, help);
+            for (std::size_t i = 0; i < fileOutcomeCount; ++i) {
+                auto const outcome = toString(static_cast<FileOutcome>(i));
+                os << prefix << name << "_total{outcome=\""sv << outcome << "\"} "sv << totals[i].*value << '\n'
+                   << prefix << name << "_created{outcome=\""sv << outcome << "\"} "sv << Number{created} << '\n';
+            }
+        }
+
+    }
+
+
+    void writeOpenMetrics(
+            std::ostream&       os,
+            RunMetrics const&   run
+        )
+    {
+        Totals totals;
+        if (run.report != nullptr) {
+            for (auto const& file : run.report->files()) {
+                auto& total = totals[static_cast<std::size_t>(file.outcome)];
+                ++total.files;
+                total.input  += file.inputSize;
+                total.output += file.outputSize;
+            }
+        }
+
+        writeOutcomeCounter(os, "files"sv, {}, "Files processed by outcome."sv,
+            totals, &OutcomeTotals::files, run.started);
+        writeOutcomeCounter(os, "input_bytes"sv, "bytes"sv, "Size of the processed files by outcome."sv,
+            totals, &OutcomeTotals::input, run.started);
+        writeOutcomeCounter(os, "output_bytes"sv, "bytes"sv, "Size of the results by outcome."sv,
+            totals, &OutcomeTotals::output, run.started);
+
+        writeFamily(os, "errors"sv, "counter"sv, {}, "Errors of the run."sv);
+        os << prefix << "errors_total "sv << run.errors << '\n'
+           << prefix << "errors_created "sv << Number{run.started} << '\n';
+
+        // Skipped files are not read, so they do not add to the throughput.
+        auto const bytesRead = totals[static_cast<std::size_t>(FileOutcome::Unchanged)].input
+                             + totals[static_cast<std::size_t>(FileOutcome::Converted)].input;
+
+        writeFamily(os, "run_duration_seconds"sv, "gauge"sv, "seconds"sv, "Wall time of the run."sv);
+        os << prefix << "run_duration_seconds "sv << Number{run.seconds} << '\n';
+
+        writeFamily(os, "throughput_bytes_per_second"sv, "gauge"sv, "bytes_per_second"sv,
+            "Bytes of the files read per second of the run."sv);
+        os << prefix << "throughput_bytes_per_second "sv
+           << Number{run.seconds > 0 ? static_cast<double>(bytesRead) / run.seconds : 0.0} << '\n';
+
+        writeFamily(os, "last_run_timestamp_seconds"sv, "gauge"sv, "seconds"sv, "Unix time the run ended."sv);
+        os << prefix << "last_run_timestamp_seconds "sv << Number{run.started + run.seconds} << '\n';
+
+        if (run.stats != nullptr) {
+            writeFamily(os, "phase_duration_seconds"sv, "histogram"sv, "seconds"sv,
+                "Latency of the phases of processing a file."sv);
+            for (std::size_t i = 0; i < phaseCount; ++i) {
+                auto const  phase     = toString(static_cast<Phase>(i));
+                auto const& histogram = run.stats->histogram(static_cast<Phase>(i));
+                auto const  labels    = "{phase=\""s + std::string{phase} + '"';
+                for (auto const nominal : latencyBuckets) {
+                    auto const limit = LatencyHistogram::bucketLimit(LatencyHistogram::bucketOf(nominal));
+                    os << prefix << "phase_duration_seconds_bucket"sv << labels
+                       << ",le=\""sv << Number{static_cast<double>(limit) / 1e9} << "\"} "sv
+                       << histogram.countAtMost(limit) << '\n';
+                }
+
+                auto const count = histogram.count();
+                os << prefix << "phase_duration_seconds_bucket"sv << labels << ",le=\"+Inf\"} "sv << count << '\n'
+                   << prefix << "phase_duration_seconds_count"sv << labels << "} "sv << count << '\n'
+                   << prefix << "phase_duration_seconds_sum"sv << labels << "} "sv
+                   << Number{static_cast<double>(histogram.sum()) / 1e9} << '\n'
+                   << prefix << "phase_duration_seconds_created"sv << labels << "} "sv << Number{run.started} << '\n';
+            }
+        }
+
+        os << "# EOF\n"sv;
+    }
+
+    void writeMetricsFile(
+            FileSystem&                     fileSystem,
+            std::filesystem::path const&    path,
+            RunMetrics const&               run
+        )
+    {
+        auto file = fileSystem.writeTemp(path);
+        try {
+            writeOpenMetrics(*file.stream, run);
+            file.stream->flush();
+            if (!*file.stream) {
+                throw std::runtime_error("File write failed: "s + file.path.string());
+            }
+
+            file.stream.reset();
+        } catch (...) {
+            file.stream.reset();
+            fileSystem.remove(file.path);
+            throw;
+        }
+
+        fileSystem.replace(file.path, path);
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_metrics()
+    {
+        int errors = 0;
+        auto check = [&errors](bool ok, std::string_view what)
+            {
+                if (!ok) {
+                    std::clog << "Test failed: metrics "sv << what << '\n';
+                    ++errors;
+                }
+            };
+
+        try {
+            Report report;
+            report.add({ "a.c", FileOutcome::Converted, 10, 12, {} });
+            report.add({ "b.c", FileOutcome::Converted, 20, 24, {} });
+            report.add({ "c.c", FileOutcome::Skipped,   30, 30, {} });
+
+            Stats stats;
+            stats.record(Phase::Read, 500);
+            stats.record(Phase::Read, 999);     // just under 1 µs
+            stats.record(Phase::Read, 1'023);   // the limit of the bucket holding 1 µs
+            stats.record(Phase::Read, 1'024);
+            stats.record(Phase::Read, 2'000'000);
+
+            RunMetrics run;
+            run.report  = &report;
+            run.stats   = &stats;
+            run.errors  = 1;
+            run.started = 1000;
+            run.seconds = 2;
+
+            std::ostringstream os;
+            writeOpenMetrics(os, run);
+            auto const text = os.str();
+            auto has = [&text](std::string_view line)
+                {
+                    return text.find("\n"s + std::string{line} + '\n') != std::string::npos;
+                };
+
+            check(text.starts_with("# TYPE tabs2spaces_files counter\n"sv) && text.ends_with("\n# EOF\n"sv), "framing");
+            check(has("tabs2spaces_files_total{outcome=\"converted\"} 2"sv)
+               && has("tabs2spaces_files_total{outcome=\"unchanged\"} 0"sv)
+               && has("tabs2spaces_input_bytes_total{outcome=\"skipped\"} 30"sv)
+               && has("tabs2spaces_output_bytes_total{outcome=\"converted\"} 36"sv)
+               && has("tabs2spaces_files_created{outcome=\"converted\"} 1000"sv), "outcome counters");
+            check(has("tabs2spaces_errors_total 1"sv)
+               && has("tabs2spaces_run_duration_seconds 2"sv)
+               && has("tabs2spaces_throughput_bytes_per_second 15"sv)
+               && has("tabs2spaces_last_run_timestamp_seconds 1002"sv), "run gauges");
+            check(has("tabs2spaces_phase_duration_seconds_bucket{phase=\"read\",le=\"1.023e-06\"} 3"sv)
+               && has("tabs2spaces_phase_duration_seconds_bucket{phase=\"read\",le=\"1.0239e-05\"} 4"sv)
+               && has("tabs2spaces_phase_duration_seconds_bucket{phase=\"read\",le=\"0.001048575\"} 4"sv)
+               && has("tabs2spaces_phase_duration_seconds_bucket{phase=\"read\",le=\"0.010485759\"} 5"sv)
+               && has("tabs2spaces_phase_duration_seconds_bucket{phase=\"read\",le=\"+Inf\"} 5"sv)
+               && has("tabs2spaces_phase_duration_seconds_sum{phase=\"read\"} 0.002003546"sv)
+               && has("tabs2spaces_phase_duration_seconds_count{phase=\"write\"} 0"sv), "histograms");
+
+            // The file is replaced whole.
+            MemoryFileSystem files;
+            files.addFile("metrics.prom", "old");
+            run.stats = nullptr;
+            writeMetricsFile(files, "metrics.prom", run);
+            auto const written = files.file("metrics.prom");
+            check(written != nullptr && written->starts_with("# TYPE"sv) && written->ends_with("# EOF\n"sv)
+               && written->find("phase_duration"sv) == std::string::npos
+               && files.list(".").size() == 1, "file");
+        } catch (std::exception const& e) {
+            check(false, e.what());
+        }
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
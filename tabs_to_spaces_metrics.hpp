@@ -0,0 +1,50 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_METRICS_HPP
+#define TABS_TO_SPACES_METRICS_HPP
+
+#include <filesystem>
+#include <ostream>
+#include <cstdint>
+
+namespace TabsToSpaces
+{
+
+    class FileSystem;
+    class Report;
+    class Stats;
+
+    // What a run did, exported as metrics.
+    struct RunMetrics
+    {
+        Report const*   report  = nullptr;  // files and bytes by outcome
+        Stats const*    stats   = nullptr;  // phase latency histograms, none if null
+        std::uint64_t   errors  = 0;
+        double          started = 0;        // Unix time in seconds
+        double          seconds = 0;        // duration of the run
+    };
+
+    // The run in the OpenMetrics text format: counters of the files, bytes and errors
+    // (created at the start of the run), gauges of the duration, throughput and end time,
+    // and histograms of the phase latencies.
+    void writeOpenMetrics(
+            std::ostream&       os,
+            RunMetrics const&   run
+        );
+
+    // Write the metrics to a temporary file next to the path and rename it over the path,
+    // so a collector reading the file never sees it partly written.
+    void writeMetricsFile(
+            FileSystem&                     fileSystem,
+            std::filesystem::path const&    path,
+            RunMetrics const&               run
+        );
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_metrics();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_METRICS_HPP
@@ -0,0 +1,322 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_pipeline.hpp"
+#include "tabs_to_spaces_blake3.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <sstream>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+    AsyncReader::AsyncReader(
+            std::istream&   input,
+            Blake3*         hash,
+            std::size_t     chunkSize
+        )
+        : input_(input)
+        , hash_(hash)
+        , buffers_(pipelineBuffers, std::string(chunkSize, '\0'))
+        , sizes_(pipelineBuffers)
+        , thread_([this](std::stop_token stop) { run(stop); })
+    {
+    }
+
+    void AsyncReader::run(std::stop_token stop)
+    {
+        try {
+            for (;;) {
+                std::unique_lock lock(mutex_);
+                if (!changed_.wait(lock, stop, [this] { return produced_ - consumed_ < buffers_.size(); })) {
+                    return;
+                }
+
+                // The caller uses only the chunks before produced_.
+                auto const index = produced_ % buffers_.size();
+                lock.unlock();
+
+                auto& buffer = buffers_[index];
+                input_.read(buffer.data(), buffer.size());
+                auto const size = static_cast<std::size_t>(input_.gcount());
+                if (hash_ != nullptr) {
+                    hash_->update({ buffer.data(), size });
+                }
+
+                lock.lock();
+                sizes_[index] = size;
+                if (input_.bad()) {
+                    throw std::runtime_error("Stream read failed");
+                }
+
+                if (size == 0) {
+                    end_ = true;
+                    changed_.notify_all();
+                    return;
+                }
+
+                ++produced_;
+                changed_.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard lock(mutex_);
+            error_ = std::current_exception();
+            end_   = true;
+            changed_.notify_all();
+        }
+    }
+
+    auto AsyncReader::next()
+        -> std::string_view
+    {
+        std::unique_lock lock(mutex_);
+        if (holding_) {
+            ++consumed_;
+            holding_ = false;
+            changed_.notify_all();
+        }
+
+        changed_.wait(lock, [this] { return produced_ > consumed_ || end_; });
+        if (produced_ > consumed_) {
+            holding_ = true;
+            auto const index = consumed_ % buffers_.size();
+            return { buffers_[index].data(), sizes_[index] };
+        }
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+
+        return {};
+    }
+
+
+    AsyncWriter::AsyncWriter(
+            std::ostream&   output,
+            Blake3*         hash,
+            std::size_t     chunkSize
+        )
+        : output_(output)
+        , hash_(hash)
+        , chunkSize_(chunkSize)
+        , buffers_(pipelineBuffers)
+        , thread_([this](std::stop_token stop) { run(stop); })
+    {
+        for (auto& buffer : buffers_) {
+            buffer.reserve(chunkSize);
+        }
+    }
+
+    void AsyncWriter::run(std::stop_token stop)
+    {
+        for (;;) {
+            std::unique_lock lock(mutex_);
+            // Writes still submitted are done even when stopping.
+            if (!changed_.wait(lock, stop, [this] { return written_ < submitted_; })) {
+                return;
+            }
+
+            auto& buffer = buffers_[written_ % buffers_.size()];
+            bool const failed = error_ != nullptr;
+            lock.unlock();
+
+            if (!failed) {
+                output_.write(buffer.data(), buffer.size());
+                if (hash_ != nullptr) {
+                    hash_->update(buffer);
+                }
+            }
+
+            lock.lock();
+            if (!failed && !output_) {
+                error_ = std::make_exception_ptr(std::runtime_error("Stream write failed"));
+            }
+
+            ++written_;
+            changed_.notify_all();
+        }
+    }
+
+    void AsyncWriter::submit()
+    {
+        std::unique_lock lock(mutex_);
+        ++submitted_;
+        changed_.notify_all();
+
+        // Wait for the next buffer to be written.
+        changed_.wait(lock, [this] { return submitted_ - written_ < buffers_.size(); });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+
+        lock.unlock();
+        buffer().clear();
+    }
+
+    void AsyncWriter::commit()
+    {
+        if (buffer().size() >= chunkSize_) {
+            submit();
+        }
+    }
+
+    void AsyncWriter::write(std::string_view data)
+    {
+        while (!data.empty()) {
+            auto& current = buffer();
+            auto const taken = std::min(data.size(), chunkSize_ - std::min(chunkSize_, current.size()));
+            current.append(data.substr(0, taken));
+            data.remove_prefix(taken);
+            commit();
+        }
+    }
+
+    void AsyncWriter::finish()
+    {
+        if (!buffer().empty()) {
+            submit();
+        }
+
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [this] { return written_ == submitted_; });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+
+        output_.flush();
+        if (!output_) {
+            throw std::runtime_error("Stream write failed");
+        }
+    }
+
+
+    void ChangeDetector::output(std::string_view data)
+    {
+        if (changed_) {
+            return;
+        }
+
+        auto const matched = std::min(data.size(), unmatched_.size());
+        if (data.size() > unmatched_.size() || data != std::string_view{unmatched_}.substr(0, matched)) {
+            changed_   = true;
+            unmatched_ = std::string{};
+        } else {
+            unmatched_.erase(0, matched);
+        }
+    }
+
+
+    auto convertPipelined(
+            std::istream&   input,
+            std::ostream&   output,
+            Config const&   config,
+            Blake3*         inputHash,
+            Blake3*         outputHash,
+            std::size_t     chunkSize
+        ) -> StreamResult
+    {
+        StreamResult result;
+
+        AsyncReader     reader(input, inputHash, chunkSize);
+        AsyncWriter     writer(output, outputHash, chunkSize);
+        Converter       converter(config);
+        ChangeDetector  changes;
+
+        auto const converted = [&](std::size_t start)
+            {
+                auto const& buffer = writer.buffer();
+                changes.output(std::string_view{buffer}.substr(start));
+                result.outputSize += buffer.size() - start;
+                writer.commit();
+            };
+
+        for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+            result.inputSize += chunk.size();
+            changes.input(chunk);
+
+            auto const start = writer.buffer().size();
+            converter.convert(chunk, writer.buffer());
+            converted(start);
+        }
+
+        auto const start = writer.buffer().size();
+        converter.finish(writer.buffer());
+        converted(start);
+
+        writer.finish();
+        result.changed = changes.changed();
+        return result;
+    }
+
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_pipeline()
+    {
+        int errors = 0;
+
+        std::string text;
+        for (int i = 0; i < 3000; ++i) {
+            text += std::string(i % 5, '\t') + "line "s + std::to_string(i) + (i % 7 == 0 ? " \t\r\n"s : "\n"s);
+        }
+
+        Config trimming;
+        trimming.whitespaceBeforeNewLines = WhitespaceBeforeNewLines::Trim;
+        trimming.finalNewline             = FinalNewline::Ensure;
+
+        struct
+        {
+            std::string_view    name;
+            std::string         text;
+            Config              config;
+        } const tests[]
+        {
+            { "tabs"sv,      text,               {} },
+            { "unchanged"sv, "no tabs\nhere\n"s, {} },
+            { "empty"sv,     ""s,                {} },
+            { "trim"sv,      text,               trimming },
+        };
+
+        for (auto const& test : tests) {
+            for (std::size_t chunkSize : { std::size_t{1}, std::size_t{7}, std::size_t{4096}, pipelineChunkSize }) {
+                std::istringstream input(test.text);
+                std::ostringstream output;
+                Blake3 inputHash;
+                Blake3 outputHash;
+
+                try {
+                    auto const result = convertPipelined(input, output, test.config, &inputHash, &outputHash, chunkSize);
+                    auto const expected = tabsToSpaces(std::string_view{test.text}, test.config);
+
+                    Blake3 expectedInputHash;
+                    Blake3 expectedOutputHash;
+                    expectedInputHash.update(test.text);
+                    expectedOutputHash.update(expected);
+
+                    if (output.str() != expected
+                     || result.changed != (expected != test.text)
+                     || result.inputSize != test.text.size()
+                     || result.outputSize != expected.size()
+                     || inputHash.digest() != expectedInputHash.digest()
+                     || outputHash.digest() != expectedOutputHash.digest()) {
+                        std::clog << "Test failed: convertPipelined "sv << test.name << " with chunks of "sv << chunkSize << '\n';
+                        ++errors;
+                    }
+                } catch (std::exception const& e) {
+                    std::clog << "Test failed: convertPipelined "sv << test.name << ": "sv << e.what() << '\n';
+                    ++errors;
+                }
+            }
+        }
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
@@ -0,0 +1,168 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_PIPELINE_HPP
+#define TABS_TO_SPACES_PIPELINE_HPP
+
+#include "tabs_to_spaces.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stop_token>
+#include <exception>
+#include <cstdint>
+
+namespace TabsToSpaces
+{
+
+    class Blake3;
+
+    // Large enough for sequential I/O and small enough for the chunk to stay in cache
+    // between being read, converted and written.
+    inline constexpr std::size_t pipelineChunkSize = 1 << 20;
+
+    // Buffers of a stream: one used by the caller, the others being read or written meanwhile.
+    inline constexpr std::size_t pipelineBuffers = 3;
+
+    // Reads the stream ahead on a helper thread, so reading the next chunks overlaps
+    // processing the current one. The data read is hashed into hash unless it is null.
+    class AsyncReader
+    {
+    public:
+        explicit AsyncReader(
+                std::istream&   input,
+                Blake3*         hash        = nullptr,
+                std::size_t     chunkSize   = pipelineChunkSize
+            );
+
+        AsyncReader(AsyncReader const&) = delete;
+        auto operator=(AsyncReader const&) -> AsyncReader& = delete;
+
+        // The next chunk, empty at the end of input. It is valid until the next call.
+        [[nodiscard]] auto next()
+            -> std::string_view;
+
+    private:
+        void run(std::stop_token stop);
+
+        std::istream&               input_;
+        Blake3*                     hash_;
+        std::vector<std::string>    buffers_;
+        std::vector<std::size_t>    sizes_;
+
+        std::mutex                  mutex_;
+        std::condition_variable_any changed_;
+        std::uint64_t               produced_ = 0;  // chunks read
+        std::uint64_t               consumed_ = 0;  // chunks released by the caller
+        bool                        holding_  = false;
+        bool                        end_      = false;
+        std::exception_ptr          error_;
+
+        std::jthread                thread_;        // the last: stops before the buffers go
+    };
+
+    // Writes on a helper thread, so the caller fills the next buffer while the previous ones
+    // are written. The data written is hashed into hash unless it is null.
+    class AsyncWriter
+    {
+    public:
+        explicit AsyncWriter(
+                std::ostream&   output,
+                Blake3*         hash        = nullptr,
+                std::size_t     chunkSize   = pipelineChunkSize
+            );
+
+        AsyncWriter(AsyncWriter const&) = delete;
+        auto operator=(AsyncWriter const&) -> AsyncWriter& = delete;
+
+        // The buffer to append output to, avoiding a copy.
+        [[nodiscard]] auto buffer() noexcept
+            -> std::string&
+        {
+            return buffers_[submitted_ % buffers_.size()];
+        }
+
+        // Hand the buffer to the helper thread if it is full.
+        void commit();
+
+        void write(std::string_view data);
+
+        // Write the rest and wait until everything is written.
+        void finish();
+
+    private:
+        void submit();
+        void run(std::stop_token stop);
+
+        std::ostream&               output_;
+        Blake3*                     hash_;
+        std::size_t                 chunkSize_;
+        std::vector<std::string>    buffers_;
+
+        std::mutex                  mutex_;
+        std::condition_variable_any changed_;
+        std::uint64_t               submitted_ = 0;
+        std::uint64_t               written_   = 0;
+        std::exception_ptr          error_;
+
+        std::jthread                thread_;        // the last: stops before the buffers go
+    };
+
+    struct StreamResult
+    {
+        bool            changed     = false;
+        std::uintmax_t  inputSize   = 0;       // bytes read
+        std::uintmax_t  outputSize  = 0;       // bytes written
+    };
+
+    // Tells whether a converted stream differs from its input keeping neither:
+    // only the input not yet matched by the output is held while no difference is seen.
+    // The output lags behind the input only by the whitespace runs and the samples
+    // the converter holds.
+    class ChangeDetector
+    {
+    public:
+        void input(std::string_view data)
+        {
+            if (!changed_) {
+                unmatched_ += data;
+            }
+        }
+
+        void output(std::string_view data);
+
+        // After the whole input and output are seen.
+        [[nodiscard]] bool changed() const noexcept
+        {
+            return changed_ || !unmatched_.empty();
+        }
+
+    private:
+        std::string unmatched_;
+        bool        changed_ = false;
+    };
+
+    // Convert input to output in chunks, reading the next chunks and writing the previous ones
+    // on helper threads while converting the current one.
+    auto convertPipelined(
+            std::istream&   input,
+            std::ostream&   output,
+            Config const&   config,
+            Blake3*         inputHash   = nullptr,
+            Blake3*         outputHash  = nullptr,
+            std::size_t     chunkSize   = pipelineChunkSize
+        ) -> StreamResult;
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_pipeline();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_PIPELINE_HPP
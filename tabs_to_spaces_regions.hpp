@@ -0,0 +1,359 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_REGIONS_HPP
+#define TABS_TO_SPACES_REGIONS_HPP
+
+#include <string_view>
+#include <array>
+
+namespace TabsToSpaces
+{
+
+    // Regions where tabs are significant and must be left intact.
+    enum class TabProtection
+    {
+        None,
+        Auto,       // choose by file name (None for buffers)
+        Makefile,   // recipe lines, i.e. lines starting with a tab
+        Tsv,        // tab-separated values: all tabs are data
+        CLike,      // string and character literals of C-like languages
+    };
+
+    namespace Kernel
+    {
+
+        // Protects no tabs.
+        struct NoRegions
+        {
+            [[nodiscard]] constexpr bool tabIsSpace() const noexcept
+            {
+                return true;
+            }
+
+            constexpr void start(char const*) noexcept {}
+
+            [[nodiscard]] constexpr bool protects(char const*) noexcept
+            {
+                return false;
+            }
+
+            [[nodiscard]] constexpr bool protectsBlanks(char const*, bool) noexcept
+            {
+                return false;
+            }
+
+            constexpr void stop(char const*) noexcept {}
+        };
+
+        // Lightweight lexer telling whether a tab lies in a protected region.
+        // The input is scanned lazily only up to the queried tab, so input without tabs is never scanned.
+        // The state is carried between consecutive ranges of input passed to start.
+        class TabRegions
+        {
+        public:
+            constexpr TabRegions() noexcept = default;
+
+            constexpr explicit TabRegions(TabProtection protection) noexcept
+                : protection_(protection)
+            {
+            }
+
+            // False if tabs are data and may not be trimmed as whitespace.
+            [[nodiscard]] constexpr bool tabIsSpace() const noexcept
+            {
+                return protection_ != TabProtection::Tsv;
+            }
+
+            // A new range of input begins at from.
+            constexpr void start(char const* from) noexcept
+            {
+                cursor_ = from;
+            }
+
+            // Is the tab at the given position protected? Positions must not decrease within a range.
+            [[nodiscard]] constexpr bool protects(char const* tab) noexcept
+            {
+                switch (protection_) {
+                case TabProtection::Tsv:
+                    return true;
+
+                case TabProtection::Makefile:
+                    stop(tab + 1);
+                    return recipe_;
+
+                case TabProtection::CLike:
+                    stop(tab + 1);
+                    return state_ != State::Code
+                        && state_ != State::Slash
+                        && state_ != State::LineComment
+                        && state_ != State::BlockComment
+                        && state_ != State::BlockStar;
+
+                default:
+                    return false;
+                }
+            }
+
+            // May the blank run starting at the given position not be turned into tabs?
+            // lineStart tells whether the run begins a line. Positions must not decrease within a range.
+            [[nodiscard]] constexpr bool protectsBlanks(char const* blank, bool lineStart) noexcept
+            {
+                switch (protection_) {
+                case TabProtection::Tsv:
+                    return true; // a tab would split a field
+
+                case TabProtection::Makefile:
+                    stop(blank + 1);
+                    return lineStart || recipe_; // a tab at a line start would make a recipe line
+
+                case TabProtection::CLike:
+                    return protects(blank);
+
+                default:
+                    return false;
+                }
+            }
+
+            // The input is consumed up to the given position.
+            constexpr void stop(char const* at) noexcept
+            {
+                if (at <= cursor_) {
+                    return;
+                }
+
+                switch (protection_) {
+                case TabProtection::Makefile:
+                    scanMakefile(cursor_, at);
+                    break;
+
+                case TabProtection::CLike:
+                    scanCLike(cursor_, at);
+                    break;
+
+                default:
+                    break;
+                }
+
+                cursor_ = at;
+            }
+
+            // Does the input consumed so far leave this lexer in the state of other, wherever they stopped?
+            [[nodiscard]] constexpr bool sameState(TabRegions const& other) const noexcept
+            {
+                bool const raw = state_ == State::RawDelimiter || state_ == State::Raw || state_ == State::RawClose;
+                return protection_  == other.protection_
+                    && atLineStart_ == other.atLineStart_
+                    && recipe_      == other.recipe_
+                    && state_       == other.state_
+                    && previous_    == other.previous_
+                    && (!raw || std::string_view{ delimiter_.data(), delimiterLength_ }
+                             == std::string_view{ other.delimiter_.data(), other.delimiterLength_ })
+                    && (state_ != State::RawClose || matched_ == other.matched_);
+            }
+
+        private:
+            enum class State : unsigned char
+            {
+                Code,
+                Slash,          // after '/' in code
+                LineComment,
+                BlockComment,
+                BlockStar,      // after '*' in a block comment
+                String,
+                StringEscape,
+                Char,
+                CharEscape,
+                RawDelimiter,   // after R" up to '('
+                Raw,
+                RawClose,       // after ')' in a raw string
+            };
+
+            static constexpr std::size_t maxRawDelimiter = 16;
+
+            TabProtection   protection_ = TabProtection::None;
+            char const*     cursor_     = nullptr;
+
+            // Makefile
+            bool            atLineStart_ = true;
+            bool            recipe_      = false;
+
+            // C-like
+            State           state_       = State::Code;
+            char            previous_    = '\n';
+            std::size_t     delimiterLength_ = 0;
+            std::size_t     matched_     = 0;
+            std::array<char, maxRawDelimiter> delimiter_ {};
+
+            constexpr void scanMakefile(char const* from, char const* to) noexcept
+            {
+                std::string_view const text{ from, to };
+
+                char const* lineStart = nullptr;
+                if (auto const lf = text.rfind('\n'); lf != text.npos) {
+                    lineStart = from + lf + 1;
+                } else if (atLineStart_) {
+                    lineStart = from;
+                }
+
+                if (lineStart != nullptr) {
+                    atLineStart_ = lineStart == to;
+                    recipe_      = !atLineStart_ && *lineStart == '\t';
+                }
+            }
+
+            [[nodiscard]] static constexpr auto find(
+                    char const*         from,
+                    char const*         to,
+                    std::string_view    any
+                ) noexcept -> char const*
+            {
+                auto const pos = std::string_view{ from, to }.find_first_of(any);
+                return pos == std::string_view::npos ? to : from + pos;
+            }
+
+            [[nodiscard]] static constexpr bool isHexDigit(char ch) noexcept
+            {
+                return (ch >= '0' && ch <= '9')
+                    || (ch >= 'a' && ch <= 'f')
+                    || (ch >= 'A' && ch <= 'F');
+            }
+
+            constexpr void scanCLike(char const* const begin, char const* const end) noexcept
+            {
+                using namespace std::literals;
+
+                auto from = begin;
+                while (from != end) {
+                    switch (state_) {
+                    case State::Code:
+                        if (auto const next = find(from, end, "\"'/"sv); next != end) {
+                            auto const before = next != begin ? next[-1] : previous_;
+                            switch (*next) {
+                            case '/':
+                                state_ = State::Slash;
+                                break;
+
+                            case '"':
+                                if (before == 'R') {
+                                    state_ = State::RawDelimiter;
+                                    delimiterLength_ = 0;
+                                } else {
+                                    state_ = State::String;
+                                }
+                                break;
+
+                            default:
+                                // A quote after a (hex) digit is assumed to be a digit separator.
+                                if (!isHexDigit(before)) {
+                                    state_ = State::Char;
+                                }
+                            }
+
+                            from = next + 1;
+                        } else {
+                            from = end;
+                        }
+                        break;
+
+                    case State::Slash:
+                        if (*from == '/') {
+                            state_ = State::LineComment;
+                            ++from;
+                        } else if (*from == '*') {
+                            state_ = State::BlockComment;
+                            ++from;
+                        } else {
+                            state_ = State::Code; // rescan this character
+                        }
+                        break;
+
+                    case State::LineComment:
+                        from = find(from, end, "\n"sv);
+                        if (from != end) {
+                            state_ = State::Code;
+                            ++from;
+                        }
+                        break;
+
+                    case State::BlockComment:
+                        from = find(from, end, "*"sv);
+                        if (from != end) {
+                            state_ = State::BlockStar;
+                            ++from;
+                        }
+                        break;
+
+                    case State::BlockStar:
+                        if (*from == '/') {
+                            state_ = State::Code;
+                        } else if (*from != '*') {
+                            state_ = State::BlockComment;
+                        }
+                        ++from;
+                        break;
+
+                    case State::String:
+                    case State::Char:
+                        from = find(from, end, state_ == State::String ? "\"\\\n"sv : "'\\\n"sv);
+                        if (from != end) {
+                            if (*from == '\\') {
+                                state_ = state_ == State::String ? State::StringEscape : State::CharEscape;
+                            } else {
+                                state_ = State::Code; // closed or unterminated at the end of line
+                            }
+                            ++from;
+                        }
+                        break;
+
+                    case State::StringEscape:
+                    case State::CharEscape:
+                        state_ = state_ == State::StringEscape ? State::String : State::Char;
+                        ++from;
+                        break;
+
+                    case State::RawDelimiter:
+                        if (*from == '(') {
+                            state_ = State::Raw;
+                            ++from;
+                        } else if (delimiterLength_ == maxRawDelimiter
+                                || " \t\v\f\r\n\\)\""sv.find(*from) != std::string_view::npos) {
+                            state_ = State::String; // not a raw string: rescan this character
+                        } else {
+                            delimiter_[delimiterLength_++] = *from++;
+                        }
+                        break;
+
+                    case State::Raw:
+                        from = find(from, end, ")"sv);
+                        if (from != end) {
+                            state_  = State::RawClose;
+                            matched_ = 0;
+                            ++from;
+                        }
+                        break;
+
+                    case State::RawClose:
+                        if (matched_ < delimiterLength_ && *from == delimiter_[matched_]) {
+                            ++matched_;
+                        } else if (matched_ == delimiterLength_ && *from == '"') {
+                            state_ = State::Code;
+                        } else if (*from == ')') {
+                            matched_ = 0;
+                        } else {
+                            state_ = State::Raw;
+                        }
+                        ++from;
+                        break;
+                    }
+                }
+
+                previous_ = end[-1];
+            }
+        };
+
+    }
+
+}
+
+#endif//TABS_TO_SPACES_REGIONS_HPP
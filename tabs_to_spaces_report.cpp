@@ -0,0 +1,89 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_report.hpp"
+
+#include <string_view>
+#include <utility>
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+
+    auto toString(FileOutcome outcome) noexcept
+        -> std::string_view
+    {
+        switch (outcome) {
+        case FileOutcome::Unchanged: return "unchanged"sv;
+        case FileOutcome::Converted: return "converted"sv;
+        case FileOutcome::Skipped:   return "skipped"sv;
+        }
+
+        return "unknown"sv;
+    }
+
+    auto operator<<(std::ostream& os, JsonString json)
+        -> std::ostream&
+    {
+        static constexpr std::string_view hex = "0123456789abcdef"sv;
+
+        os << '"';
+        for (auto in : json.data) {
+            switch (in) {
+            case '"':  os << "\\\""sv; break;
+            case '\\': os << "\\\\"sv; break;
+            case '\n': os << "\\n"sv;  break;
+            case '\r': os << "\\r"sv;  break;
+            case '\t': os << "\\t"sv;  break;
+            default:
+                if (unsigned char code = in; code < 0x20) {
+                    os << "\\u00"sv << hex[code >> 4] << hex[code & 0xF];
+                } else {
+                    os.put(in);
+                }
+            }
+        }
+
+        os << '"';
+        return os;
+    }
+
+    auto toUtf8(std::filesystem::path const& path)
+        -> std::string
+    {
+        auto const u8 = path.generic_u8string();
+        return { reinterpret_cast<char const*>(u8.data()), u8.size() };
+    }
+
+
+    void Report::add(FileResult result)
+    {
+        files_.push_back(std::move(result));
+    }
+
+    void Report::writeJson(std::ostream& os) const
+    {
+        os << "{\n  \"files\": ["sv;
+
+        char const* separator = "\n";
+        for (auto const& file : files_) {
+            os << separator
+               << "    { \"path\": "sv      << JsonString{ toUtf8(file.path) }
+               << ", \"outcome\": "sv       << JsonString{ toString(file.outcome) }
+               << ", \"inputBytes\": "sv    << file.inputSize
+               << ", \"outputBytes\": "sv   << file.outputSize;
+
+            if (!file.hash.empty()) {
+                os << ", \"blake3\": "sv << JsonString{ file.hash };
+            }
+
+            os << " }"sv;
+            separator = ",\n";
+        }
+
+        os << "\n  ]\n}\n"sv;
+    }
+
+}
@@ -0,0 +1,97 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_REPORT_HPP
+#define TABS_TO_SPACES_REPORT_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+#include <ostream>
+#include <cstdint>
+
+namespace TabsToSpaces
+{
+
+    // Text written with << as a JSON string literal.
+    struct JsonString
+    {
+        std::string_view data;
+    };
+
+    auto operator<<(std::ostream& os, JsonString json)
+        -> std::ostream&;
+
+    // The path as UTF-8 with / separators, as paths are written in JSON.
+    [[nodiscard]] auto toUtf8(std::filesystem::path const& path)
+        -> std::string;
+
+    enum class OutputHash
+    {
+        None,
+        Blake3,     // hash the output while it is written
+    };
+
+    enum class FileOutcome
+    {
+        Unchanged,
+        Converted,
+        Skipped,    // marked clean, not read
+    };
+
+    inline constexpr std::size_t fileOutcomeCount = 3;
+
+    // The name of the outcome as written in reports.
+    [[nodiscard]] auto toString(FileOutcome outcome) noexcept
+        -> std::string_view;
+
+    // Result of processing one file.
+    struct FileResult
+    {
+        std::filesystem::path   path;
+        FileOutcome             outcome     = FileOutcome::Unchanged;
+        std::uintmax_t          inputSize   = 0;
+        std::uintmax_t          outputSize  = 0;
+        std::string             hash;       // hex BLAKE3 of the output, empty if not computed
+    };
+
+    // Collects the results of processed files.
+    class Report
+    {
+    public:
+        explicit Report(OutputHash outputHash = OutputHash::None) noexcept
+            : outputHash_(outputHash)
+        {
+        }
+
+        [[nodiscard]] auto outputHash() const noexcept
+            -> OutputHash
+        {
+            return outputHash_;
+        }
+
+        // Applies to the files added afterwards.
+        void setOutputHash(OutputHash outputHash) noexcept
+        {
+            outputHash_ = outputHash;
+        }
+
+        void add(FileResult result);
+
+        [[nodiscard]] auto files() const noexcept
+            -> std::vector<FileResult> const&
+        {
+            return files_;
+        }
+
+        void writeJson(std::ostream& os) const;
+
+    private:
+        OutputHash              outputHash_;
+        std::vector<FileResult> files_;
+    };
+
+}
+
+#endif//TABS_TO_SPACES_REPORT_HPP
@@ -0,0 +1,322 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_stats.hpp"
+#include "tabs_to_spaces.hpp"
+#include "tabs_to_spaces_report.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+    namespace
+    {
+
+        [[nodiscard]] bool slower(
+                FileTiming const& a,
+                FileTiming const& b
+            ) noexcept
+        {
+            return a.nanoseconds > b.nanoseconds;
+        }
+
+        [[nodiscard]] bool larger(
+                FileTiming const& a,
+                FileTiming const& b
+            ) noexcept
+        {
+            return a.size > b.size;
+        }
+
+        // Keep the capacity greatest files by the order in a heap with the least one at the front.
+        template <typename Greater>
+        void keepTop(
+                std::vector<FileTiming>&    top,
+                std::size_t                 capacity,
+                FileTiming                  file,
+                Greater                     greater
+            )
+        {
+            if (top.size() < capacity) {
+                top.push_back(std::move(file));
+                std::ranges::push_heap(top, greater);
+            } else if (capacity != 0 && greater(file, top.front())) {
+                std::ranges::pop_heap(top, greater);
+                top.back() = std::move(file);
+                std::ranges::push_heap(top, greater);
+            }
+        }
+
+        template <typename Greater>
+        [[nodiscard]] auto sorted(
+                std::vector<FileTiming> top,
+                Greater                 greater
+            ) -> std::vector<FileTiming>
+        {
+            std::ranges::sort(top, greater);
+            return top;
+        }
+
+        // Three significant digits with the unit.
+        [[nodiscard]] auto formatDuration(std::uint64_t nanoseconds)
+            -> std::string
+        {
+            constexpr std::pair<double, std::string_view> units[]
+            {
+                { 1e9, "s"sv  },
+                { 1e6, "ms"sv },
+                { 1e3, "us"sv },
+            };
+
+            std::ostringstream os;
+            for (auto const& [scale, unit] : units) {
+                if (static_cast<double>(nanoseconds) >= scale) {
+                    auto const value = static_cast<double>(nanoseconds) / scale;
+                    os << std::fixed << std::setprecision(value < 9.995 ? 2 : value < 99.95 ? 1 : 0) << value << ' ' << unit;
+                    return os.str();
+                }
+            }
+
+            os << nanoseconds << " ns"sv;
+            return os.str();
+        }
+
+        void writeFiles(
+                std::ostream&                   os,
+                std::string_view                title,
+                std::vector<FileTiming> const&  files
+            )
+        {
+            if (files.empty()) {
+                return;
+            }
+
+            os << title << ":\n"sv;
+            for (auto const& file : files) {
+                os << std::setw(12) << formatDuration(file.nanoseconds)
+                   << std::setw(14) << file.size << " B  "sv
+                   << toUtf8(file.path) << '\n';
+            }
+        }
+
+    }
+
+
+    void LatencyHistogram::record(std::uint64_t value) noexcept
+    {
+        counts_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        for (auto max = max_.load(std::memory_order_relaxed);
+             value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed); ) {
+        }
+    }
+
+    void LatencyHistogram::merge(LatencyHistogram const& other) noexcept
+    {
+        for (std::size_t i = 0; i < bucketCount; ++i) {
+            if (auto const count = other.counts_[i].load(std::memory_order_relaxed); count != 0) {
+                counts_[i].fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+
+        sum_.fetch_add(other.sum(), std::memory_order_relaxed);
+
+        auto const otherMax = other.max();
+        for (auto max = max_.load(std::memory_order_relaxed);
+             otherMax > max && !max_.compare_exchange_weak(max, otherMax, std::memory_order_relaxed); ) {
+        }
+    }
+
+    auto LatencyHistogram::count() const noexcept
+        -> std::uint64_t
+    {
+        std::uint64_t total = 0;
+        for (auto const& count : counts_) {
+            total += count.load(std::memory_order_relaxed);
+        }
+
+        return total;
+    }
+
+    auto LatencyHistogram::countAtMost(std::uint64_t limit) const noexcept
+        -> std::uint64_t
+    {
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < bucketCount && bucketLimit(i) <= limit; ++i) {
+            total += counts_[i].load(std::memory_order_relaxed);
+        }
+
+        return total;
+    }
+
+    auto LatencyHistogram::percentile(double fraction) const noexcept
+        -> std::uint64_t
+    {
+        auto const total = count();
+        if (total == 0) {
+            return 0;
+        }
+
+        // The rank of the value, at least the first one.
+        auto const rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(fraction * static_cast<double>(total) + 0.5));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < bucketCount; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(bucketLimit(i), max());
+            }
+        }
+
+        return max();
+    }
+
+
+    auto toString(Phase phase) noexcept
+        -> std::string_view
+    {
+        switch (phase) {
+        case Phase::Stat:    return "stat"sv;
+        case Phase::Read:    return "read"sv;
+        case Phase::Convert: return "convert"sv;
+        case Phase::Write:   return "write"sv;
+        }
+
+        return "unknown"sv;
+    }
+
+
+    Stats::Stats(std::size_t topCount)
+        : topCount_(topCount)
+    {
+        slowest_.reserve(topCount_);
+        largest_.reserve(topCount_);
+    }
+
+    void Stats::record(
+            Phase           phase,
+            std::uint64_t   nanoseconds
+        ) noexcept
+    {
+        phases_[static_cast<std::size_t>(phase)].record(nanoseconds);
+    }
+
+    void Stats::addFile(FileTiming file)
+    {
+        keepTop(largest_, topCount_, file, larger);
+        keepTop(slowest_, topCount_, std::move(file), slower);
+    }
+
+    void Stats::merge(Stats const& other)
+    {
+        for (std::size_t i = 0; i < phaseCount; ++i) {
+            phases_[i].merge(other.phases_[i]);
+        }
+
+        for (auto const& file : other.slowest_) {
+            keepTop(slowest_, topCount_, file, slower);
+        }
+
+        for (auto const& file : other.largest_) {
+            keepTop(largest_, topCount_, file, larger);
+        }
+    }
+
+    auto Stats::slowest() const
+        -> std::vector<FileTiming>
+    {
+        return sorted(slowest_, slower);
+    }
+
+    auto Stats::largest() const
+        -> std::vector<FileTiming>
+    {
+        return sorted(largest_, larger);
+    }
+
+    void Stats::write(std::ostream& os) const
+    {
+        os << std::left << std::setw(10) << "phase"sv << std::right << std::setw(10) << "count"sv
+           << std::setw(12) << "p50"sv << std::setw(12) << "p90"sv
+           << std::setw(12) << "p99"sv << std::setw(12) << "max"sv << '\n';
+
+        for (std::size_t i = 0; i < phaseCount; ++i) {
+            auto const& histogram = phases_[i];
+            os << std::left << std::setw(10) << toString(static_cast<Phase>(i)) << std::right
+               << std::setw(10) << histogram.count()
+               << std::setw(12) << formatDuration(histogram.percentile(0.5))
+               << std::setw(12) << formatDuration(histogram.percentile(0.9))
+               << std::setw(12) << formatDuration(histogram.percentile(0.99))
+               << std::setw(12) << formatDuration(histogram.max()) << '\n';
+        }
+
+        writeFiles(os, "Slowest files"sv, slowest());
+        writeFiles(os, "Largest files"sv, largest());
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_stats()
+    {
+        int errors = 0;
+        auto check = [&errors](bool ok, std::string_view what)
+            {
+                if (!ok) {
+                    std::clog << "Test failed: Stats "sv << what << '\n';
+                    ++errors;
+                }
+            };
+
+        static_assert(LatencyHistogram::bucketOf(15) == 15);
+        static_assert(LatencyHistogram::bucketOf(16) == 16 && LatencyHistogram::bucketOf(17) == 16);
+        static_assert(LatencyHistogram::bucketLimit(LatencyHistogram::bucketOf(1000)) >= 1000);
+        static_assert(LatencyHistogram::bucketOf(~std::uint64_t{0}) == LatencyHistogram::bucketCount - 1);
+        static_assert(LatencyHistogram::bucketLimit(LatencyHistogram::bucketCount - 1) == ~std::uint64_t{0});
+
+        LatencyHistogram histogram;
+        for (std::uint64_t value = 1; value <= 1000; ++value) {
+            histogram.record(value);
+        }
+
+        // Within the 12.5 % of a bucket.
+        auto near = [](std::uint64_t value, std::uint64_t expected)
+            {
+                return value >= expected && value <= expected + expected / 8;
+            };
+
+        check(histogram.count() == 1000 && histogram.max() == 1000
+           && near(histogram.percentile(0.5), 500)
+           && near(histogram.percentile(0.99), 990)
+           && histogram.percentile(1.0) == 1000, "percentiles");
+
+        check(histogram.sum() == 500500 && histogram.countAtMost(15) == 15
+           && histogram.countAtMost(1000) >= 1000 - 1000 / 8 && histogram.countAtMost(~std::uint64_t{0}) == 1000, "cumulative counts");
+
+        // Top files of two threads merged.
+        Stats total(2);
+        Stats other(2);
+        total.addFile({ "a", 10, 300 });
+        total.addFile({ "b", 40, 100 });
+        other.addFile({ "c", 30, 200 });
+        other.addFile({ "d", 20, 400 });
+        other.record(Phase::Read, 5);
+        total.merge(other);
+
+        auto const slowest = total.slowest();
+        auto const largest = total.largest();
+        check(slowest.size() == 2 && slowest[0].path == "d" && slowest[1].path == "a"
+           && largest.size() == 2 && largest[0].path == "b" && largest[1].path == "c"
+           && total.histogram(Phase::Read).count() == 1, "top files");
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
@@ -0,0 +1,184 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_STATS_HPP
+#define TABS_TO_SPACES_STATS_HPP
+
+#include <string_view>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <ostream>
+#include <bit>
+#include <algorithm>
+#include <cstdint>
+
+namespace TabsToSpaces
+{
+
+    // Latencies counted in buckets of logarithmic width like HDR histograms: exact below 16,
+    // then 8 buckets per power of two, so a value is reported within 12.5 %. Recording is
+    // a relaxed atomic increment: no locks, and readers may look while a thread records.
+    class LatencyHistogram
+    {
+    public:
+        static constexpr int            subBucketBits = 3;
+        static constexpr std::size_t    subBuckets    = std::size_t{1} << subBucketBits;
+        static constexpr std::size_t    bucketCount   = (64 - subBucketBits + 1) * subBuckets;
+
+        [[nodiscard]] static constexpr auto bucketOf(std::uint64_t value) noexcept
+            -> std::size_t
+        {
+            auto const exponent = std::max(static_cast<int>(std::bit_width(value)), subBucketBits + 1) - (subBucketBits + 1);
+            return static_cast<std::size_t>(exponent) * subBuckets + static_cast<std::size_t>(value >> exponent);
+        }
+
+        // The largest value of the bucket.
+        [[nodiscard]] static constexpr auto bucketLimit(std::size_t bucket) noexcept
+            -> std::uint64_t
+        {
+            auto const exponent = bucket < 2 * subBuckets ? 0 : bucket / subBuckets - 1;
+            auto const mantissa = std::uint64_t{bucket - exponent * subBuckets};
+            return ((mantissa + 1) << exponent) - 1;
+        }
+
+        void record(std::uint64_t value) noexcept;
+
+        void merge(LatencyHistogram const& other) noexcept;
+
+        [[nodiscard]] auto count() const noexcept
+            -> std::uint64_t;
+
+        // The number of the values in the buckets entirely not above the limit, so
+        // the values up to 12.5 % below it may be missed unless the limit is a bucketLimit.
+        [[nodiscard]] auto countAtMost(std::uint64_t limit) const noexcept
+            -> std::uint64_t;
+
+        [[nodiscard]] auto sum() const noexcept
+            -> std::uint64_t
+        {
+            return sum_.load(std::memory_order_relaxed);
+        }
+
+        // The value not exceeded by the fraction (0 to 1) of the recorded values, 0 if none.
+        [[nodiscard]] auto percentile(double fraction) const noexcept
+            -> std::uint64_t;
+
+        [[nodiscard]] auto max() const noexcept
+            -> std::uint64_t
+        {
+            return max_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::array<std::atomic<std::uint64_t>, bucketCount> counts_ {};
+        std::atomic<std::uint64_t>                          max_    {};
+        std::atomic<std::uint64_t>                          sum_    {};
+    };
+
+    enum class Phase
+    {
+        Stat,
+        Read,
+        Convert,        // streamed files (compressed or large) spend reading and writing here too
+        Write,
+    };
+
+    inline constexpr std::size_t phaseCount = 4;
+
+    [[nodiscard]] auto toString(Phase phase) noexcept
+        -> std::string_view;
+
+    struct FileTiming
+    {
+        std::filesystem::path   path;
+        std::uint64_t           size        = 0;    // bytes read
+        std::uint64_t           nanoseconds = 0;
+    };
+
+    // Latencies of the phases in nanoseconds and the slowest and largest files, at most
+    // topCount of each. A thread records into its own Stats, merged into the total after.
+    class Stats
+    {
+    public:
+        explicit Stats(std::size_t topCount = 10);
+
+        Stats(Stats const&) = delete;
+        auto operator=(Stats const&) -> Stats& = delete;
+
+        void record(
+                Phase           phase,
+                std::uint64_t   nanoseconds
+            ) noexcept;
+
+        void addFile(FileTiming file);
+
+        void merge(Stats const& other);
+
+        [[nodiscard]] auto topCount() const noexcept
+            -> std::size_t
+        {
+            return topCount_;
+        }
+
+        [[nodiscard]] auto histogram(Phase phase) const noexcept
+            -> LatencyHistogram const&
+        {
+            return phases_[static_cast<std::size_t>(phase)];
+        }
+
+        // The slowest and the largest first.
+        [[nodiscard]] auto slowest() const
+            -> std::vector<FileTiming>;
+
+        [[nodiscard]] auto largest() const
+            -> std::vector<FileTiming>;
+
+        // A table of the percentiles of the phases, then the lists of files.
+        void write(std::ostream& os) const;
+
+    private:
+        std::size_t                                 topCount_;
+        std::array<LatencyHistogram, phaseCount>    phases_;
+        std::vector<FileTiming>                     slowest_;   // heaps with the least at the front
+        std::vector<FileTiming>                     largest_;
+    };
+
+    // Time of work() recorded as the phase unless stats is null; returns the result of work.
+    template <typename Work>
+    auto timed(
+            Stats*  stats,
+            Phase   phase,
+            Work&&  work
+        ) -> decltype(work())
+    {
+        if (stats == nullptr) {
+            return work();
+        }
+
+        struct Record
+        {
+            Stats*                                  stats;
+            Phase                                   phase;
+            std::chrono::steady_clock::time_point   start = std::chrono::steady_clock::now();
+
+            ~Record()
+            {
+                auto const elapsed = std::chrono::steady_clock::now() - start;
+                stats->record(phase, static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        } const record{ stats, phase };
+
+        return work();
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_stats();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_STATS_HPP
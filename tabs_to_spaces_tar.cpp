@@ -0,0 +1,782 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_tar.hpp"
+#include "tabs_to_spaces_blake3.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <optional>
+#include <charconv>
+#include <cstdint>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <sstream>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+
+    namespace
+    {
+
+        [[nodiscard]] constexpr bool matchWildcard(
+                std::string_view pattern,
+                std::string_view name
+            ) noexcept
+        {
+            std::size_t p = 0, n = 0;
+            std::size_t star = pattern.npos, starName = 0;
+            while (n < name.size()) {
+                if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                    ++p;
+                    ++n;
+                } else if (p < pattern.size() && pattern[p] == '*') {
+                    star = p++;
+                    starName = n;
+                } else if (star != pattern.npos) {
+                    // Let the last * take one more character.
+                    p = star + 1;
+                    n = ++starName;
+                } else {
+                    return false;
+                }
+            }
+
+            while (p < pattern.size() && pattern[p] == '*') {
+                ++p;
+            }
+
+            return p == pattern.size();
+        }
+
+        [[nodiscard]] constexpr auto withoutDotSlash(std::string_view name) noexcept
+            -> std::string_view
+        {
+            while (name.starts_with("./"sv)) {
+                name.remove_prefix(2);
+            }
+
+            return name;
+        }
+
+        // Split "dir/name" into "dir" and "name" ("" and "name" if there is no directory).
+        [[nodiscard]] constexpr auto splitName(std::string_view name) noexcept
+            -> std::pair<std::string_view, std::string_view>
+        {
+            auto const slash = name.rfind('/');
+            if (slash == name.npos) {
+                return { {}, name };
+            }
+
+            return { name.substr(0, slash), name.substr(slash + 1) };
+        }
+
+    }
+
+    bool matchesTarMember(
+            TarRule const&      rule,
+            std::string_view    memberName
+        ) noexcept
+    {
+        auto const pattern = withoutDotSlash(rule.pattern);
+        auto const name    = withoutDotSlash(memberName);
+
+        auto const [directory, filePattern] = splitName(pattern);
+        if (filePattern.find_first_of("*?"sv) == filePattern.npos) {
+            return name == pattern;
+        }
+
+        auto const [memberDirectory, memberFile] = splitName(name);
+        bool const inDirectory = memberDirectory == directory
+            || (rule.config.directoryWalk == DirectoryWalk::Nested
+                && (directory.empty()
+                    || (memberDirectory.starts_with(directory) && memberDirectory[directory.size()] == '/')));
+
+        return inDirectory && matchWildcard(filePattern, memberFile);
+    }
+
+    namespace
+    {
+
+        constexpr std::size_t blockSize  = 512;
+        constexpr std::size_t recordSize = 20 * blockSize;  // the default blocking factor of tar
+        constexpr std::size_t copySize   = 128 * blockSize;
+
+        using Block = std::array<char, blockSize>;
+
+        struct Field
+        {
+            std::size_t offset;
+            std::size_t size;
+        };
+
+        constexpr Field nameField     {   0, 100 };
+        constexpr Field sizeField     { 124,  12 };
+        constexpr Field checksumField { 148,   8 };
+        constexpr Field typeField     { 156,   1 };
+        constexpr Field magicField    { 257,   6 };
+        constexpr Field prefixField   { 345, 155 };
+
+        [[nodiscard]] auto fieldText(
+                Block const&    header,
+                Field           field
+            ) noexcept -> std::string_view
+        {
+            std::string_view const text{ header.data() + field.offset, field.size };
+            return text.substr(0, text.find('\0'));
+        }
+
+        [[nodiscard]] constexpr auto padding(std::uint64_t size) noexcept
+            -> std::size_t
+        {
+            return static_cast<std::size_t>((blockSize - size % blockSize) % blockSize);
+        }
+
+        // Octal or GNU base-256 (for values not fitting the octal digits) number.
+        [[nodiscard]] auto parseNumber(
+                Block const&    header,
+                Field           field
+            ) -> std::uint64_t
+        {
+            auto const bytes = reinterpret_cast<unsigned char const*>(header.data() + field.offset);
+            std::uint64_t value = 0;
+
+            if ((bytes[0] & 0x80) != 0) {
+                if (bytes[0] == 0xFF) {
+                    throw std::runtime_error("tar: negative number in header");
+                }
+
+                value = bytes[0] & 0x7F;
+                for (std::size_t i = 1; i < field.size; ++i) {
+                    if ((value >> 56) != 0) {
+                        throw std::runtime_error("tar: number in header is too big");
+                    }
+
+                    value = (value << 8) | bytes[i];
+                }
+
+                return value;
+            }
+
+            std::size_t i = 0;
+            while (i < field.size && bytes[i] == ' ') {
+                ++i;
+            }
+
+            for (; i < field.size && bytes[i] != '\0' && bytes[i] != ' '; ++i) {
+                if (bytes[i] < '0' || bytes[i] > '7') {
+                    throw std::runtime_error("tar: invalid number in header");
+                }
+
+                if ((value >> 61) != 0) {
+                    throw std::runtime_error("tar: number in header is too big");
+                }
+
+                value = (value << 3) | (bytes[i] - '0');
+            }
+
+            return value;
+        }
+
+        void writeNumber(
+                Block&          header,
+                Field           field,
+                std::uint64_t   value
+            ) noexcept
+        {
+            auto const bytes  = header.data() + field.offset;
+            auto const digits = field.size - 1;
+
+            if (digits * 3 >= 64 || (value >> (digits * 3)) == 0) {
+                bytes[digits] = '\0';
+                for (auto i = digits; i != 0; --i, value >>= 3) {
+                    bytes[i - 1] = static_cast<char>('0' + (value & 7));
+                }
+            } else {
+                for (auto i = field.size; i != 0; --i, value >>= 8) {
+                    bytes[i - 1] = static_cast<char>(value & 0xFF);
+                }
+
+                bytes[0] = static_cast<char>(0x80);
+            }
+        }
+
+        [[nodiscard]] auto checksum(Block const& header) noexcept
+            -> std::uint64_t
+        {
+            std::uint64_t sum = ' ' * checksumField.size;
+            for (std::size_t i = 0; i < header.size(); ++i) {
+                if (i - checksumField.offset >= checksumField.size) {
+                    sum += static_cast<unsigned char>(header[i]);
+                }
+            }
+
+            return sum;
+        }
+
+        void checkChecksum(Block const& header)
+        {
+            if (parseNumber(header, checksumField) != checksum(header)) {
+                throw std::runtime_error("tar: header checksum mismatch");
+            }
+        }
+
+        void updateChecksum(Block& header) noexcept
+        {
+            // Six octal digits, NUL and space like tar writes it.
+            writeNumber(header, { checksumField.offset, 7 }, checksum(header));
+            header[checksumField.offset + 7] = ' ';
+        }
+
+        [[nodiscard]] bool isZero(Block const& block) noexcept
+        {
+            return std::ranges::all_of(block, [](char byte) { return byte == '\0'; });
+        }
+
+        // Types of members having no data whatever their size field says.
+        [[nodiscard]] bool hasNoData(char type) noexcept
+        {
+            return "123456"sv.contains(type);
+        }
+
+        [[nodiscard]] bool isRegularFile(char type) noexcept
+        {
+            return type == '0' || type == '\0' || type == '7';
+        }
+
+        struct PaxRecord
+        {
+            std::string key;
+            std::string value;
+        };
+
+        // Records of the form "length key=value\n", the length counting the whole record.
+        [[nodiscard]] auto parsePax(std::string_view data)
+            -> std::vector<PaxRecord>
+        {
+            std::vector<PaxRecord> records;
+            while (!data.empty() && data.front() != '\0') {
+                std::size_t length = 0;
+                auto const [end, ec] = std::from_chars(data.data(), data.data() + data.size(), length);
+                auto const space = static_cast<std::size_t>(end - data.data());
+
+                if (ec != std::errc{} || space >= data.size() || data[space] != ' '
+                 || length <= space + 1 || length > data.size() || data[length - 1] != '\n') {
+                    throw std::runtime_error("tar: invalid pax header");
+                }
+
+                auto const record = data.substr(space + 1, length - space - 2);
+                auto const equals = record.find('=');
+                if (equals == record.npos) {
+                    throw std::runtime_error("tar: invalid pax header");
+                }
+
+                records.push_back({ std::string{record.substr(0, equals)}, std::string{record.substr(equals + 1)} });
+                data.remove_prefix(length);
+            }
+
+            return records;
+        }
+
+        [[nodiscard]] auto formatPax(std::vector<PaxRecord> const& records)
+            -> std::string
+        {
+            std::string data;
+            for (auto const& [key, value] : records) {
+                auto const body = key.size() + value.size() + 3;  // ' ', '=' and '\n'
+
+                // The length includes its own digits.
+                auto length = body + 1;
+                while (std::to_string(length).size() + body != length) {
+                    length = std::to_string(length).size() + body;
+                }
+
+                data += std::to_string(length);
+                data += ' ';
+                data += key;
+                data += '=';
+                data += value;
+                data += '\n';
+            }
+
+            return data;
+        }
+
+        [[nodiscard]] auto findPax(
+                std::vector<PaxRecord>& records,
+                std::string_view        key
+            ) noexcept -> PaxRecord*
+        {
+            auto const found = std::ranges::find(records, key, &PaxRecord::key);
+            return found != records.end() ? &*found : nullptr;
+        }
+
+        // Name of the member: that of the header combined with the ustar prefix.
+        [[nodiscard]] auto headerName(Block const& header)
+            -> std::string
+        {
+            std::string name{ fieldText(header, nameField) };
+
+            // GNU tar keeps other data in the prefix field and marks it with "ustar  ".
+            std::string_view const magic{ header.data() + magicField.offset, magicField.size };
+            if (auto const prefix = fieldText(header, prefixField); magic == "ustar\0"sv && !prefix.empty()) {
+                name = std::string{prefix} + '/' + name;
+            }
+
+            return name;
+        }
+
+        class TarReader
+        {
+        public:
+            explicit TarReader(std::istream& input) noexcept
+                : input_(input)
+            {
+            }
+
+            // False at the end of input.
+            [[nodiscard]] bool readHeader(Block& header)
+            {
+                input_.read(header.data(), header.size());
+                if (input_.gcount() == 0) {
+                    return false;
+                }
+
+                if (static_cast<std::size_t>(input_.gcount()) != header.size()) {
+                    throw std::runtime_error("tar: unexpected end of archive");
+                }
+
+                return true;
+            }
+
+            // Member data without the padding which is skipped.
+            [[nodiscard]] auto readData(std::uint64_t size)
+                -> std::string
+            {
+                if (size > SIZE_MAX - blockSize) {
+                    throw std::length_error("tar: member is too big");
+                }
+
+                std::string data(static_cast<std::size_t>(size), '\0');
+                read(data.data(), data.size());
+                skip(padding(size));
+                return data;
+            }
+
+            // Copy member data with its padding.
+            void copyData(
+                    std::uint64_t   size,
+                    std::ostream&   output
+                )
+            {
+                size += padding(size);
+                while (size != 0) {
+                    auto const chunk = static_cast<std::size_t>(std::min<std::uint64_t>(size, buffer_.size()));
+                    read(buffer_.data(), chunk);
+                    output.write(buffer_.data(), chunk);
+                    size -= chunk;
+                }
+            }
+
+        private:
+            void read(
+                    char*       data,
+                    std::size_t size
+                )
+            {
+                input_.read(data, size);
+                if (static_cast<std::size_t>(input_.gcount()) != size) {
+                    throw std::runtime_error("tar: unexpected end of archive");
+                }
+            }
+
+            void skip(std::size_t size)
+            {
+                input_.ignore(size);
+                if (static_cast<std::size_t>(input_.gcount()) != size) {
+                    throw std::runtime_error("tar: unexpected end of archive");
+                }
+            }
+
+            std::istream&                   input_;
+            std::vector<char>               buffer_ = std::vector<char>(copySize);
+        };
+
+        // Counts the bytes written for padding the archive to a full record.
+        class TarWriter
+        {
+        public:
+            explicit TarWriter(std::ostream& output) noexcept
+                : output_(output)
+            {
+            }
+
+            [[nodiscard]] auto stream() noexcept
+                -> std::ostream&
+            {
+                return output_;
+            }
+
+            void write(std::string_view data)
+            {
+                output_.write(data.data(), data.size());
+                written_ += data.size();
+            }
+
+            void write(Block const& header)
+            {
+                write(std::string_view{ header.data(), header.size() });
+            }
+
+            // Data followed by the padding to the block boundary.
+            void writeData(std::string_view data)
+            {
+                write(data);
+                write(std::string_view{ zero_.data(), padding(data.size()) });
+            }
+
+            void copied(std::uint64_t size) noexcept
+            {
+                written_ += size + padding(size);
+            }
+
+            void finish()
+            {
+                // Two zero blocks end the archive.
+                write(zero_);
+                write(zero_);
+                while (written_ % recordSize != 0) {
+                    write(zero_);
+                }
+
+                output_.flush();
+                if (!output_) {
+                    throw std::runtime_error("tar: write failed");
+                }
+            }
+
+        private:
+            std::ostream&   output_;
+            std::uint64_t   written_ = 0;
+            Block           zero_{};
+        };
+
+        [[nodiscard]] auto memberPath(std::string_view name)
+            -> std::filesystem::path
+        {
+            return std::u8string_view{ reinterpret_cast<char8_t const*>(name.data()), name.size() };
+        }
+
+    }
+
+    void convertTar(
+            std::istream&               input,
+            std::ostream&               output,
+            std::span<TarRule const>    rules,
+            Report*                     report
+        )
+    {
+        TarReader reader(input);
+        TarWriter writer(output);
+
+        // Extended headers apply to the next member and are written before it.
+        std::string             gnuHeaders;     // GNU long name and long link members as is
+        std::string             longName;
+        std::optional<Block>    paxHeader;
+        std::string             paxData;
+
+        Block header;
+        while (reader.readHeader(header) && !isZero(header)) {
+            checkChecksum(header);
+
+            auto const type = header[typeField.offset];
+            auto size = parseNumber(header, sizeField);
+
+            if (type == 'L' || type == 'K') {
+                auto const data = reader.readData(size);
+                if (type == 'L') {
+                    longName = data.substr(0, data.find('\0'));
+                }
+
+                gnuHeaders.append(header.data(), header.size());
+                gnuHeaders += data;
+                gnuHeaders.append(padding(size), '\0');
+                continue;
+            }
+
+            if (type == 'x') {
+                paxHeader = header;
+                paxData   = reader.readData(size);
+                continue;
+            }
+
+            auto pax = parsePax(paxData);
+            std::string name = longName.empty() ? headerName(header) : longName;
+            if (auto const path = findPax(pax, "path"sv)) {
+                name = path->value;
+            }
+
+            if (auto const paxSize = findPax(pax, "size"sv)) {
+                auto const& value = paxSize->value;
+                if (std::from_chars(value.data(), value.data() + value.size(), size).ptr != value.data() + value.size()) {
+                    throw std::runtime_error("tar: invalid pax size");
+                }
+            }
+
+            if (hasNoData(type)) {
+                size = 0;
+            }
+
+            auto const rule = isRegularFile(type)
+                ? std::ranges::find_if(rules, [&name](TarRule const& r) { return matchesTarMember(r, name); })
+                : rules.end();
+
+            std::string data;
+            std::string converted;
+            if (rule != rules.end()) {
+                auto config = rule->config;
+                if (config.tabProtection == TabProtection::Auto) {
+                    config.tabProtection = detectTabProtection(memberPath(name));
+                }
+
+                data      = reader.readData(size);
+                converted = tabsToSpaces(std::string_view{data}, config);
+
+                if (converted != data) {
+                    // A pax size record overrides the header.
+                    if (auto const paxSize = findPax(pax, "size"sv)) {
+                        paxSize->value = std::to_string(converted.size());
+                        paxData = formatPax(pax);
+                        writeNumber(*paxHeader, sizeField, paxData.size());
+                        updateChecksum(*paxHeader);
+                    }
+
+                    writeNumber(header, sizeField, converted.size());
+                    updateChecksum(header);
+                }
+            }
+
+            writer.write(gnuHeaders);
+            if (paxHeader) {
+                writer.write(*paxHeader);
+                writer.writeData(paxData);
+            }
+
+            writer.write(header);
+
+            if (rule != rules.end()) {
+                writer.writeData(converted);
+
+                if (report != nullptr) {
+                    FileResult result;
+                    result.path       = memberPath(name);
+                    result.outcome    = converted != data ? FileOutcome::Converted : FileOutcome::Unchanged;
+                    result.inputSize  = data.size();
+                    result.outputSize = converted.size();
+
+                    if (report->outputHash() == OutputHash::Blake3) {
+                        Blake3 hash;
+                        hash.update(converted);
+                        result.hash = Blake3::toHex(hash.digest());
+                    }
+
+                    report->add(std::move(result));
+                }
+            } else {
+                reader.copyData(size, writer.stream());
+                writer.copied(size);
+            }
+
+            gnuHeaders.clear();
+            longName.clear();
+            paxHeader.reset();
+            paxData.clear();
+        }
+
+        if (!gnuHeaders.empty() || paxHeader) {
+            throw std::runtime_error("tar: extended header without member");
+        }
+
+        writer.finish();
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    namespace
+    {
+
+        [[nodiscard]] auto makeHeader(
+                std::string_view    name,
+                char                type,
+                std::uint64_t       size
+            ) -> Block
+        {
+            Block header{};
+            std::ranges::copy(name.substr(0, nameField.size), header.begin());
+            writeNumber(header, { 100, 8 }, 0644);
+            writeNumber(header, sizeField, size);
+            header[typeField.offset] = type;
+            std::ranges::copy("ustar\0" "00"sv, header.begin() + magicField.offset);
+            updateChecksum(header);
+            return header;
+        }
+
+        // Builds archives the way tar does.
+        struct TestTar
+        {
+            std::string         bytes;
+
+            void add(Block const& header, std::string_view data = {})
+            {
+                bytes.append(header.data(), header.size());
+                bytes += data;
+                bytes.append(padding(data.size()), '\0');
+            }
+
+            void file(std::string_view name, std::string_view data)
+            {
+                add(makeHeader(name, '0', data.size()), data);
+            }
+
+            void longNameFile(std::string_view name, std::string_view data)
+            {
+                std::string longName{name};
+                longName += '\0';
+                add(makeHeader("././@LongLink"sv, 'L', longName.size()), longName);
+                add(makeHeader(name.substr(0, nameField.size), '0', data.size()), data);
+            }
+
+            void paxFile(std::string_view name, std::string_view data)
+            {
+                auto const pax = formatPax({ { "path", std::string{name} }, { "size", std::to_string(data.size()) } });
+                add(makeHeader("PaxHeaders/x"sv, 'x', pax.size()), pax);
+                add(makeHeader("x"sv, '0', data.size()), data);
+            }
+
+            auto finish()
+                -> std::string
+            {
+                bytes.append(2 * blockSize, '\0');
+                bytes.append((recordSize - bytes.size() % recordSize) % recordSize, '\0');
+                return std::move(bytes);
+            }
+        };
+
+    }
+
+    int test_tar()
+    {
+        int errors = 0;
+
+        constexpr struct
+        {
+            std::string_view    pattern;
+            DirectoryWalk       walk;
+            std::string_view    member;
+            bool                matches;
+        } matchTests[]
+        {
+            { "*.c"sv,          DirectoryWalk::OneLevel, "a.c"sv,           true  },
+            { "*.c"sv,          DirectoryWalk::OneLevel, "./a.c"sv,         true  },
+            { "*.c"sv,          DirectoryWalk::OneLevel, "src/a.c"sv,       false },
+            { "*.c"sv,          DirectoryWalk::Nested,   "src/a.c"sv,       true  },
+            { "src/*.c"sv,      DirectoryWalk::OneLevel, "src/a.c"sv,       true  },
+            { "src/*.c"sv,      DirectoryWalk::OneLevel, "src/x/a.c"sv,     false },
+            { "src/*.c"sv,      DirectoryWalk::Nested,   "src/x/a.c"sv,     true  },
+            { "src/*.c"sv,      DirectoryWalk::Nested,   "srcx/a.c"sv,      false },
+            { "src/a?.*"sv,     DirectoryWalk::OneLevel, "src/ab.cpp"sv,    true  },
+            { "src/a?.*"sv,     DirectoryWalk::OneLevel, "src/a.cpp"sv,     false },
+            { "*a*b*"sv,        DirectoryWalk::OneLevel, "xaxxbx"sv,        true  },
+            { "*a*b"sv,         DirectoryWalk::OneLevel, "xaxxbx"sv,        false },
+            { "src/a.c"sv,      DirectoryWalk::Nested,   "src/a.c"sv,       true  },
+            { "a.c"sv,          DirectoryWalk::Nested,   "src/a.c"sv,       false },
+        };
+
+        for (auto const& test : matchTests) {
+            Config config;
+            config.directoryWalk = test.walk;
+            if (matchesTarMember({ std::string{test.pattern}, config }, test.member) != test.matches) {
+                std::clog << "Test failed: matchesTarMember("sv << test.pattern << ", "sv << test.member << ")\n"sv;
+                ++errors;
+            }
+        }
+
+        auto const longName = std::string(120, 'n') + ".c";
+        auto const big      = std::string(700, '\t') + "x\n";
+        auto const bigSpaces = std::string(2800, ' ') + "x\n";
+
+        TestTar input;
+        input.add(makeHeader("src/"sv, '5', 0));
+        input.file("src/a.c"sv, "\tint a;\n"sv);
+        input.file("src/b.txt"sv, "\tkeep\n"sv);
+        input.file("src/big.c"sv, big);
+        input.longNameFile("src/" + longName, "\tlong\n"sv);
+        input.paxFile("src/pax.c"sv, "\tpax\n"sv);
+        input.add(makeHeader("src/link.c"sv, '2', 0));
+
+        TestTar expected;
+        expected.add(makeHeader("src/"sv, '5', 0));
+        expected.file("src/a.c"sv, "    int a;\n"sv);
+        expected.file("src/b.txt"sv, "\tkeep\n"sv);
+        expected.file("src/big.c"sv, bigSpaces);
+        expected.longNameFile("src/" + longName, "    long\n"sv);
+        expected.paxFile("src/pax.c"sv, "    pax\n"sv);
+        expected.add(makeHeader("src/link.c"sv, '2', 0));
+
+        Config config;
+        TarRule const rules[] { { "src/*.c", config } };
+
+        std::istringstream in(input.finish());
+        std::ostringstream out;
+        Report report;
+        try {
+            convertTar(in, out, rules, &report);
+            if (out.str() != expected.finish()) {
+                std::clog << "Test failed: convertTar output differs\n"sv;
+                ++errors;
+            }
+
+            if (report.files().size() != 4
+             || report.files()[0].path != "src/a.c"
+             || report.files()[0].outputSize != 11
+             || report.files()[3].path != "src/pax.c") {
+                std::clog << "Test failed: convertTar report\n"sv;
+                ++errors;
+            }
+        } catch (std::exception const& e) {
+            std::clog << "Test failed: convertTar: "sv << e.what() << '\n';
+            ++errors;
+        }
+
+        // Sizes beyond the octal field are written in base-256.
+        Block header{};
+        writeNumber(header, sizeField, 077777777777);
+        writeNumber(header, { 0, 12 }, 0100000000000);
+        if (parseNumber(header, sizeField) != 077777777777
+         || header[sizeField.offset + 11] != '\0'
+         || parseNumber(header, { 0, 12 }) != 0100000000000
+         || static_cast<unsigned char>(header[0]) != 0x80) {
+            std::clog << "Test failed: tar header numbers\n"sv;
+            ++errors;
+        }
+
+        // Corrupt headers are not copied blindly.
+        std::istringstream corruptIn(TestTar{ .bytes = std::string(1, 'x') + std::string(blockSize - 1, '\0') }.finish());
+        std::ostringstream corruptOut;
+        try {
+            convertTar(corruptIn, corruptOut, rules);
+            std::clog << "Test failed: convertTar accepted a bad checksum\n"sv;
+            ++errors;
+        } catch (std::runtime_error const&) {
+        }
+
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
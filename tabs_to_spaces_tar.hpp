@@ -0,0 +1,51 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_TAR_HPP
+#define TABS_TO_SPACES_TAR_HPP
+
+#include "tabs_to_spaces.hpp"
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <istream>
+#include <ostream>
+
+namespace TabsToSpaces
+{
+
+    // Members matching the pattern are converted with the config.
+    // The pattern follows the rules of file arguments: the file name part may contain * and ?,
+    // then the directory part selects the members in that directory of the archive
+    // (and its subdirectories if config.directoryWalk is Nested); otherwise it is the member name.
+    struct TarRule
+    {
+        std::string pattern;
+        Config      config;
+    };
+
+    [[nodiscard]] bool matchesTarMember(
+            TarRule const&      rule,
+            std::string_view    memberName
+        ) noexcept;
+
+    // Copy a tar archive from input to output converting the regular file members
+    // which match a rule (the first matching rule applies), with their headers fixed up.
+    // The archive is streamed block by block: only the member being converted is kept in memory.
+    // ustar, GNU (long names, base-256 sizes) and pax (path and size records) headers are understood.
+    // The converted members are added to the report unless it is null.
+    void convertTar(
+            std::istream&               input,
+            std::ostream&               output,
+            std::span<TarRule const>    rules,
+            Report*                     report = nullptr
+        );
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_tar();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_TAR_HPP
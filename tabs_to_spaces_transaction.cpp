@@ -0,0 +1,377 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#include "tabs_to_spaces_transaction.hpp"
+#include "tabs_to_spaces_file_system.hpp"
+#include "tabs_to_spaces_report.hpp"
+#include "tabs_to_spaces.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <charconv>
+#include <exception>
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+namespace TabsToSpaces
+{
+
+    using namespace std::literals;
+    namespace fs = std::filesystem;
+
+    namespace
+    {
+
+        // The journal: a header, the current directory of the run (relative paths are under it),
+        // then a line per file: "saved <tab> link number <tab> path" or "created <tab> path".
+        constexpr std::string_view journalHeader    = "tabs2spaces transaction 1"sv;
+        constexpr std::string_view directoryRecord  = "directory"sv;
+        constexpr std::string_view savedRecord      = "saved"sv;
+        constexpr std::string_view createdRecord    = "created"sv;
+
+        [[nodiscard]] auto fromUtf8(std::string_view text)
+            -> fs::path
+        {
+            return std::u8string{ text.begin(), text.end() };
+        }
+
+        [[nodiscard]] auto journalPath(fs::path const& directory)
+            -> fs::path
+        {
+            return directory / transactionJournal;
+        }
+
+        struct JournalEntry
+        {
+            fs::path    link;       // empty if the file was created
+            fs::path    path;
+        };
+
+        [[nodiscard]] auto readJournal(
+                FileSystem&     fileSystem,
+                fs::path const& directory
+            ) -> std::vector<JournalEntry>
+        {
+            auto const journal = journalPath(directory);
+            auto const text    = fileSystem.read(journal);
+            auto invalid = [&journal]
+                {
+                    return std::runtime_error("Invalid transaction journal: "s + journal.string());
+                };
+
+            std::string_view rest{text};
+            auto nextLine = [&rest]
+                {
+                    auto const end  = rest.find('\n');
+                    auto const line = rest.substr(0, end);
+                    rest.remove_prefix(end == rest.npos ? rest.size() : end + 1);
+                    return line;
+                };
+
+            // Up to the tab, removing it from the line.
+            auto nextField = [](std::string_view& line)
+                {
+                    auto const end   = line.find('\t');
+                    auto const field = line.substr(0, end);
+                    line.remove_prefix(end == line.npos ? line.size() : end + 1);
+                    return field;
+                };
+
+            if (nextLine() != journalHeader) {
+                throw invalid();
+            }
+
+            auto directoryLine = nextLine();
+            if (nextField(directoryLine) != directoryRecord) {
+                throw invalid();
+            }
+
+            // Paths are used as recorded when rolling back from the directory of the run.
+            auto const base = fromUtf8(directoryLine);
+            std::error_code ec;
+            bool const sameDirectory = fs::equivalent(base, fs::current_path(ec), ec);
+            auto resolve = [&](std::string_view path)
+                {
+                    auto resolved = fromUtf8(path);
+                    return resolved.is_relative() && !sameDirectory ? base / resolved : resolved;
+                };
+
+            std::vector<JournalEntry> entries;
+            while (!rest.empty()) {
+                auto line = nextLine();
+                auto const record = nextField(line);
+                if (record == savedRecord) {
+                    auto const number = nextField(line);
+                    std::size_t link = 0;
+                    if (std::from_chars(number.data(), number.data() + number.size(), link).ec != std::errc{}) {
+                        throw invalid();
+                    }
+
+                    entries.push_back({ directory / std::to_string(link), resolve(line) });
+                } else if (record == createdRecord) {
+                    entries.push_back({ {}, resolve(line) });
+                } else {
+                    throw invalid();
+                }
+            }
+
+            return entries;
+        }
+
+        void removeSnapshot(
+                FileSystem&                         fileSystem,
+                fs::path const&                     directory,
+                std::vector<JournalEntry> const&    entries
+            )
+        {
+            for (auto const& entry : entries) {
+                if (!entry.link.empty()) {
+                    fileSystem.remove(entry.link);
+                }
+            }
+
+            fileSystem.remove(journalPath(directory));
+            fileSystem.remove(directory);
+        }
+
+    }
+
+
+    Transaction::Transaction(
+            FileSystem& fileSystem,
+            fs::path    directory
+        )
+        : fileSystem_(fileSystem)
+        , directory_(std::move(directory))
+    {
+        fileSystem_.createDirectories(directory_);
+
+        auto const journal = journalPath(directory_);
+        if (fileSystem_.status(journal).type != FileType::NotFound) {
+            throw std::invalid_argument("Transaction directory holds a transaction: "s + directory_.string());
+        }
+
+        journal_ = fileSystem_.openAppend(journal);
+        *journal_ << journalHeader << '\n' << directoryRecord << '\t' << toUtf8(fs::current_path()) << '\n';
+        journal_->flush();
+    }
+
+    void Transaction::save(fs::path const& path)
+    {
+        if (!saved_.insert(path.lexically_normal()).second) {
+            return;
+        }
+
+        auto const utf8 = toUtf8(path);
+        if (utf8.find('\n') != utf8.npos) {
+            throw std::invalid_argument("New-line in a path of a transaction: "s + path.string());
+        }
+
+        if (fileSystem_.status(path).type == FileType::NotFound) {
+            *journal_ << createdRecord << '\t' << utf8 << '\n';
+        } else {
+            auto const link = directory_ / std::to_string(++links_);
+            try {
+                fileSystem_.link(path, link);
+            } catch (fs::filesystem_error const&) {
+                fileSystem_.copy(path, link);
+            }
+
+            *journal_ << savedRecord << '\t' << links_ << '\t' << utf8 << '\n';
+        }
+
+        if (!journal_->flush()) {
+            throw std::runtime_error("Transaction journal write failed: "s + journalPath(directory_).string());
+        }
+    }
+
+
+    void commitTransaction(
+            FileSystem&     fileSystem,
+            fs::path const& directory
+        )
+    {
+        removeSnapshot(fileSystem, directory, readJournal(fileSystem, directory));
+    }
+
+    void rollbackTransaction(
+            FileSystem&     fileSystem,
+            fs::path const& directory,
+            unsigned        threads
+        )
+    {
+        auto const entries = readJournal(fileSystem, directory);
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // The entries are distinct paths, so the renames are independent.
+        std::vector<std::string> errors(entries.size());
+        std::atomic<std::size_t> next = 0;
+        auto const worker = [&]
+            {
+                for (auto i = next++; i < entries.size(); i = next++) {
+                    auto const& entry = entries[i];
+                    try {
+                        if (entry.link.empty()) {
+                            fileSystem.remove(entry.path);
+                        } else if (fileSystem.status(entry.link).type != FileType::NotFound) {
+                            fileSystem.replace(entry.link, entry.path);
+                        }
+                    } catch (std::exception const& e) {
+                        errors[i] = e.what();
+                    }
+                }
+            };
+
+        {
+            std::vector<std::jthread> helpers;
+            while (helpers.size() + 1 < std::min<std::size_t>(threads, entries.size())) {
+                helpers.emplace_back(worker);
+            }
+
+            worker();
+        }
+
+        if (auto const failed = std::ranges::find_if(errors, [](auto const& error) { return !error.empty(); });
+                failed != errors.end()) {
+            throw std::runtime_error("Rollback failed: "s + *failed);
+        }
+
+        removeSnapshot(fileSystem, directory, entries);
+    }
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_transaction()
+    {
+        int errors = 0;
+        auto check = [&errors](bool ok, std::string_view what)
+            {
+                if (!ok) {
+                    std::clog << "Test failed: Transaction "sv << what << '\n';
+                    ++errors;
+                }
+            };
+
+        try {
+            MemoryFileSystem files;
+            files.addFile("src/a.c", "\ta\n");
+            files.addFile("src/b.c", "b\n");
+
+            {
+                Transaction transaction(files, "snapshot");
+                FileOptions options;
+                options.fileSystem  = &files;
+                options.transaction = &transaction;
+
+                // The second conversion of a.c keeps the first snapshot.
+                Report report;
+                Config config;
+                tabsToSpaces("src/*.c", config, report, options);
+                config.tabWidth   = 2;
+                config.conversion = Conversion::SpacesToTabs;
+                tabsToSpaces("src/a.c", config, report, options);
+
+                options.outputDirectory = "out";
+                tabsToSpaces("src/b.c", Config{}, report, options);
+
+                check(*files.file("src/a.c") == "\t\ta\n"
+                   && *files.file("out/src/b.c") == "b\n"
+                   && *files.file("snapshot/1") == "\ta\n"
+                   && files.file("snapshot/2") == nullptr, "snapshot");
+
+                bool refused = false;
+                try {
+                    Transaction second(files, "snapshot");
+                } catch (std::invalid_argument const&) {
+                    refused = true;
+                }
+
+                check(refused, "in a used directory");
+            }
+
+            rollbackTransaction(files, "snapshot", 1);
+            check(*files.file("src/a.c") == "\ta\n"
+               && *files.file("src/b.c") == "b\n"
+               && files.file("out/src/b.c") == nullptr
+               && files.file("snapshot/journal") == nullptr
+               && files.file("snapshot/1") == nullptr, "rollback");
+
+            {
+                Transaction transaction(files, "snapshot");
+                FileOptions options;
+                options.fileSystem  = &files;
+                options.transaction = &transaction;
+                Report report;
+                tabsToSpaces("src/a.c", Config{}, report, options);
+            }
+
+            commitTransaction(files, "snapshot");
+            check(*files.file("src/a.c") == "    a\n"
+               && files.file("snapshot/journal") == nullptr
+               && files.file("snapshot/1") == nullptr, "commit");
+        } catch (std::exception const& e) {
+            std::clog << "Test failed: Transaction: "sv << e.what() << '\n';
+            ++errors;
+        }
+
+        // On disk the snapshot is a hard link, so an existing output copied over must be replaced, not rewritten.
+        auto const directory = fs::temp_directory_path()
+            / ("tabs2spaces-test-"s + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        try {
+            auto write = [](fs::path const& path, std::string_view text)
+                {
+                    std::ofstream(path, std::ios::binary) << text;
+                };
+            auto read = [](fs::path const& path)
+                {
+                    std::ostringstream text;
+                    text << std::ifstream(path, std::ios::binary).rdbuf();
+                    return std::move(text).str();
+                };
+
+            NativeFileSystem files;
+            auto const source = directory / "b.c";
+            auto const output = directory / "out";
+            fs::create_directories(directory);
+            write(source, "b\n");
+
+            auto const target = output / fs::absolute(source).relative_path();
+            fs::create_directories(target.parent_path());
+            write(target, "old\n");
+
+            {
+                Transaction transaction(files, directory / "snapshot");
+                FileOptions options;
+                options.fileSystem      = &files;
+                options.transaction     = &transaction;
+                options.outputDirectory = output;
+
+                Report report;
+                tabsToSpaces(source, Config{}, report, options);
+            }
+
+            check(read(target) == "b\n", "output directory on disk");
+            rollbackTransaction(files, directory / "snapshot", 1);
+            check(read(target) == "old\n" && read(source) == "b\n", "rollback of an output directory on disk");
+        } catch (std::exception const& e) {
+            std::clog << "Test failed: Transaction: "sv << e.what() << '\n';
+            ++errors;
+        }
+
+        std::error_code ignored;
+        fs::remove_all(directory, ignored);
+        return errors;
+    }
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
@@ -0,0 +1,75 @@
+﻿// Copyright (c) 2025, D.R.Kuvshinov. All rights reserved.
+// This file is part of TabsToSpaces utility
+// See LICENSE file for license and warranty information.
+#ifndef TABS_TO_SPACES_TRANSACTION_HPP
+#define TABS_TO_SPACES_TRANSACTION_HPP
+
+#include <filesystem>
+#include <ostream>
+#include <memory>
+#include <set>
+#include <string_view>
+#include <cstddef>
+
+namespace TabsToSpaces
+{
+
+    class FileSystem;
+
+    // Name of the journal in a transaction directory.
+    inline constexpr std::string_view transactionJournal = "journal";
+
+    // Snapshot of the files a run replaces or creates. The conversion writes a new file
+    // and renames it over the original, so a hard link to the original keeps its content
+    // for one metadata operation and no data copy (a copy is made if linking fails,
+    // e.g. across devices). The directory holds the numbered links and a journal of
+    // the paths, written through as it grows so an interrupted run can be rolled back.
+    class Transaction
+    {
+    public:
+        // The directory is created if missing and must not hold another transaction.
+        Transaction(
+                FileSystem&             fileSystem,
+                std::filesystem::path   directory
+            );
+
+        [[nodiscard]] auto directory() const noexcept
+            -> std::filesystem::path const&
+        {
+            return directory_;
+        }
+
+        // Keep the file before it is replaced or note that it is created if it does not exist.
+        // Only the first call for a path counts, so the snapshot keeps the state before the run.
+        void save(std::filesystem::path const& path);
+
+    private:
+        FileSystem&                         fileSystem_;
+        std::filesystem::path               directory_;
+        std::unique_ptr<std::ostream>       journal_;
+        std::set<std::filesystem::path>     saved_;
+        std::size_t                         links_ = 0;
+    };
+
+    // Keep the results: delete the snapshot in the directory.
+    void commitTransaction(
+            FileSystem&                     fileSystem,
+            std::filesystem::path const&    directory
+        );
+
+    // Rename the originals back and remove the created files on threads (as many as
+    // the hardware runs if 0), then delete the snapshot. If some files fail, the snapshot
+    // is kept and the first failure is thrown as std::runtime_error.
+    void rollbackTransaction(
+            FileSystem&                     fileSystem,
+            std::filesystem::path const&    directory,
+            unsigned                        threads = 0
+        );
+
+#ifdef  TABS_TO_SPACES_TEST_ENABLED
+    int test_transaction();
+#endif//TABS_TO_SPACES_TEST_ENABLED
+
+}
+
+#endif//TABS_TO_SPACES_TRANSACTION_HPP